@@ -0,0 +1,41 @@
+#ifndef CODEC_H
+#define CODEC_H
+
+// Conversión entre el JSON de telemetría (firmware y data.json antiguo) y
+// Record. Incluye un lector JSON mínimo, suficiente para data.json.
+
+#include <store.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct JsonValue {
+  enum Type { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_OBJECT, JSON_ARRAY };
+
+  Type type = JSON_NULL;
+  bool boolean = false;
+  double number = 0;
+  std::string str;
+  std::vector<std::pair<std::string, JsonValue>> members;
+  std::vector<JsonValue> items;
+
+  const JsonValue* get(const char* key) const;
+};
+
+bool parseJson(const std::string& text, JsonValue& out, std::string* err);
+
+// Acepta tanto los nombres cortos del firmware (trash, temp...) como los
+// largos de las primeras versiones (trashLevel, temperature...). false si el
+// id no es válido (SeriesStore::validDeviceId).
+bool recordFromJson(const JsonValue& obj, int64_t tsMs, Record& rec, std::string& device);
+std::string recordToJson(const Record& rec, const std::string& device);
+void appendEscaped(std::string& out, const std::string& s);   // Entre comillas
+std::string bucketToJson(const Bucket& b);
+
+// ISO 8601 UTC ("2025-07-01T21:20:53.867Z") o milisegundos desde epoch
+bool parseTime(const std::string& s, int64_t& tsMs);
+std::string formatTime(int64_t tsMs);
+
+#endif
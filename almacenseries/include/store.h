@@ -0,0 +1,126 @@
+#ifndef STORE_H
+#define STORE_H
+
+// Almacén de series temporales append-only para la telemetría de /data.
+//
+// Los datos viven en segmentos seg-NNNNNN.log de registros de 40 bytes,
+// ordenados por timestamp. Cada segmento lleva un índice disperso (un
+// timestamp cada INDEX_STRIDE registros) que se guarda en seg-NNNNNN.idx al
+// sellarlo. Así "desde T" y los rangos cuestan O(log n + k) en vez de
+// releer todo el histórico, y "último valor" sale de una caché en memoria.
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#pragma pack(push, 1)
+struct Record {
+  int64_t tsMs;       // Hora de llegada al servidor (ms desde epoch)
+  uint16_t device;    // Índice en devices.txt
+  uint8_t flags;      // RECORD_FLAME | RECORD_WIN | RECORD_BUTTON
+  uint8_t trash;      // %
+  int16_t temp10;     // Décimas de grado
+  uint8_t hum;        // %
+  uint8_t bat;        // %
+  int32_t tokens;
+  int32_t deps;
+  uint32_t uptime;    // Campo "time" del firmware (s)
+  int32_t ttf;        // Segundos hasta lleno estimados por el firmware, -1 = no se llena
+  int16_t rate10;     // Velocidad de llenado en décimas de %/h
+  uint16_t reserved;
+  uint32_t checksum;  // FNV-1a de los bytes anteriores
+};
+#pragma pack(pop)
+
+static_assert(sizeof(Record) == 40, "Record debe medir 40 bytes");
+
+enum RecordFlags {
+  RECORD_FLAME = 1,
+  RECORD_WIN = 2,
+  RECORD_BUTTON = 4
+};
+
+// Agregado de un intervalo para consultas submuestreadas
+struct Bucket {
+  int64_t startMs;
+  uint32_t count;
+  float trashAvg, trashMin, trashMax;
+  float tempAvg;
+  float humAvg;
+  float batAvg;
+  int32_t tokens;     // Último valor del intervalo
+  int32_t deps;
+  bool flame;         // Hubo fuego en algún momento
+};
+
+class SeriesStore {
+public:
+  static const uint32_t INDEX_STRIDE = 128;
+
+  // Sin comillas, '\\' ni caracteres de control: el id va tal cual a
+  // devices.txt y como clave en las respuestas JSON
+  static bool validDeviceId(const std::string& name);
+
+  explicit SeriesStore(const std::string& dir, uint32_t segmentRecords = 65536);
+  ~SeriesStore();
+
+  bool open(std::string* err);
+  void close();
+
+  // El timestamp nunca retrocede: si llega uno anterior al último se ajusta.
+  bool append(Record rec, const std::string& device, std::string* err);
+
+  // Último registro de cada dispositivo (índice = device)
+  const std::vector<Record>& latest() const { return latestCache; }
+  bool hasLatest(uint16_t device) const;
+
+  void since(int64_t tsMs, size_t limit, std::vector<Record>& out) const;
+  void range(int device, int64_t fromMs, int64_t toMs, int64_t bucketMs, std::vector<Bucket>& out) const;
+
+  // Reescribe los segmentos sellados anteriores a olderThanMs dejando un
+  // registro (el último) por dispositivo y intervalo de resolutionMs.
+  bool compact(int64_t olderThanMs, int64_t resolutionMs, std::string* err);
+
+  int deviceIndex(const std::string& name) const;
+  const std::string& deviceName(uint16_t index) const { return devices[index]; }
+  size_t deviceCount() const { return devices.size(); }
+  uint64_t recordCount() const;
+  size_t segmentCount() const { return segments.size(); }
+
+  static uint32_t checksum(const Record& rec);
+
+private:
+  struct Segment {
+    uint32_t seq;
+    uint64_t count;
+    int64_t minTs;
+    int64_t maxTs;
+    std::vector<int64_t> index;   // ts del registro i * INDEX_STRIDE
+    bool sealed;
+  };
+
+  std::string dir;
+  uint32_t segmentRecords;
+  std::vector<Segment> segments;
+  std::vector<std::string> devices;
+  std::unordered_map<std::string, int> deviceIds;
+  std::vector<Record> latestCache;
+  std::vector<bool> latestValid;
+  int activeFd;
+  int64_t lastTs;
+
+  std::string segmentPath(uint32_t seq, const char* ext) const;
+  bool loadDevices(std::string* err);
+  int addDevice(const std::string& name, std::string* err);
+  bool loadSegment(uint32_t seq, bool last, std::string* err);
+  bool writeIndex(const Segment& seg) const;
+  bool openActive(std::string* err);
+  bool seal(std::string* err);
+  void rebuildLatest();
+  void finishPendingCompaction();
+  size_t findFirst(const Segment& seg, int64_t tsMs, int fd) const;
+  void scan(int64_t fromMs, int64_t toMs, size_t limit, int device, std::vector<Record>& out) const;
+};
+
+#endif
@@ -0,0 +1,277 @@
+#include <codec.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+const JsonValue* JsonValue::get(const char* key) const {
+  for (const auto& m : members) {
+    if (m.first == key) return &m.second;
+  }
+  return nullptr;
+}
+
+// ---------------------------------------------------------------------------
+// Lector JSON
+
+namespace {
+
+struct Parser {
+  const char* p;
+  const char* end;
+  std::string error;
+
+  void skipWs() {
+    while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) p++;
+  }
+
+  bool fail(const char* msg) {
+    if (error.empty()) error = msg;
+    return false;
+  }
+
+  bool literal(const char* word) {
+    size_t n = strlen(word);
+    if ((size_t)(end - p) < n || memcmp(p, word, n) != 0) return fail("literal no válido");
+    p += n;
+    return true;
+  }
+
+  bool parseString(std::string& out) {
+    if (p >= end || *p != '"') return fail("se esperaba '\"'");
+    p++;
+    while (p < end && *p != '"') {
+      if (*p == '\\') {
+        if (++p >= end) break;
+        switch (*p) {
+          case 'n': out += '\n'; break;
+          case 't': out += '\t'; break;
+          case 'r': out += '\r'; break;
+          case 'b': out += '\b'; break;
+          case 'f': out += '\f'; break;
+          case 'u': {
+            if (end - p < 5) return fail("escape \\u incompleto");
+            unsigned cp = (unsigned)strtoul(std::string(p + 1, 4).c_str(), nullptr, 16);
+            p += 4;
+            if (cp < 0x80) {
+              out += (char)cp;
+            } else if (cp < 0x800) {
+              out += (char)(0xC0 | (cp >> 6));
+              out += (char)(0x80 | (cp & 0x3F));
+            } else {
+              out += (char)(0xE0 | (cp >> 12));
+              out += (char)(0x80 | ((cp >> 6) & 0x3F));
+              out += (char)(0x80 | (cp & 0x3F));
+            }
+            break;
+          }
+          default: out += *p; break;
+        }
+        p++;
+      } else {
+        out += *p++;
+      }
+    }
+    if (p >= end) return fail("cadena sin cerrar");
+    p++;
+    return true;
+  }
+
+  bool parseValue(JsonValue& v, int depth) {
+    if (depth > 32) return fail("anidamiento excesivo");
+    skipWs();
+    if (p >= end) return fail("fin inesperado");
+    switch (*p) {
+      case '{': {
+        v.type = JsonValue::JSON_OBJECT;
+        p++;
+        skipWs();
+        if (p < end && *p == '}') { p++; return true; }
+        for (;;) {
+          skipWs();
+          std::pair<std::string, JsonValue> m;
+          if (!parseString(m.first)) return false;
+          skipWs();
+          if (p >= end || *p != ':') return fail("se esperaba ':'");
+          p++;
+          if (!parseValue(m.second, depth + 1)) return false;
+          v.members.push_back(std::move(m));
+          skipWs();
+          if (p < end && *p == ',') { p++; continue; }
+          if (p < end && *p == '}') { p++; return true; }
+          return fail("se esperaba ',' o '}'");
+        }
+      }
+      case '[': {
+        v.type = JsonValue::JSON_ARRAY;
+        p++;
+        skipWs();
+        if (p < end && *p == ']') { p++; return true; }
+        for (;;) {
+          v.items.emplace_back();
+          if (!parseValue(v.items.back(), depth + 1)) return false;
+          skipWs();
+          if (p < end && *p == ',') { p++; continue; }
+          if (p < end && *p == ']') { p++; return true; }
+          return fail("se esperaba ',' o ']'");
+        }
+      }
+      case '"':
+        v.type = JsonValue::JSON_STRING;
+        return parseString(v.str);
+      case 't':
+        v.type = JsonValue::JSON_BOOL;
+        v.boolean = true;
+        return literal("true");
+      case 'f':
+        v.type = JsonValue::JSON_BOOL;
+        return literal("false");
+      case 'n':
+        return literal("null");
+      default: {
+        char* e;
+        std::string num(p, std::min<size_t>(end - p, 64));
+        v.number = strtod(num.c_str(), &e);
+        if (e == num.c_str()) return fail("valor no válido");
+        v.type = JsonValue::JSON_NUMBER;
+        p += e - num.c_str();
+        return true;
+      }
+    }
+  }
+};
+
+}  // namespace
+
+bool parseJson(const std::string& text, JsonValue& out, std::string* err) {
+  Parser ps{text.data(), text.data() + text.size(), std::string()};
+  out = JsonValue();
+  bool ok = ps.parseValue(out, 0);
+  if (ok) {
+    ps.skipWs();
+    if (ps.p != ps.end) ok = ps.fail("datos sobrantes");
+  }
+  if (!ok && err) *err = ps.error + " (posición " + std::to_string(ps.p - text.data()) + ")";
+  return ok;
+}
+
+// ---------------------------------------------------------------------------
+// Record <-> JSON
+
+static double numberField(const JsonValue& obj, const char* shortName, const char* longName, double def) {
+  const JsonValue* v = obj.get(shortName);
+  if (!v) v = obj.get(longName);
+  if (!v) return def;
+  if (v->type == JsonValue::JSON_NUMBER) return v->number;
+  if (v->type == JsonValue::JSON_BOOL) return v->boolean ? 1 : 0;
+  return def;
+}
+
+static uint8_t percent(double v) {
+  if (std::isnan(v)) return 0;
+  return (uint8_t)std::min(100.0, std::max(0.0, v));
+}
+
+bool recordFromJson(const JsonValue& obj, int64_t tsMs, Record& r, std::string& device) {
+  memset(&r, 0, sizeof(r));
+  r.tsMs = tsMs;
+  r.trash = percent(numberField(obj, "trash", "trashLevel", 0));
+  r.temp10 = (int16_t)std::lround(std::min(3276.0, std::max(-3276.0, numberField(obj, "temp", "temperature", 0))) * 10);
+  r.hum = percent(numberField(obj, "hum", "humidity", 0));
+  r.bat = percent(numberField(obj, "bat", "batteryLevel", 0));
+  r.tokens = (int32_t)numberField(obj, "tokens", "userTokens", 0);
+  r.deps = (int32_t)numberField(obj, "deps", "dailyDeposits", 0);
+  r.uptime = (uint32_t)std::max(0.0, numberField(obj, "time", "uptime", 0));
+  r.ttf = (int32_t)numberField(obj, "ttf", "timeToFull", -1);
+  r.rate10 = (int16_t)std::lround(std::min(3276.0, std::max(-3276.0, numberField(obj, "rate", "fillRate", 0))) * 10);
+  if (numberField(obj, "flame", "flameDetected", 0)) r.flags |= RECORD_FLAME;
+  if (numberField(obj, "win", "windowOpen", 0)) r.flags |= RECORD_WIN;
+  if (numberField(obj, "button", "buttonPressed", 0)) r.flags |= RECORD_BUTTON;
+
+  const JsonValue* id = obj.get("id");
+  device = (id && id->type == JsonValue::JSON_STRING && !id->str.empty()) ? id->str : "sin_id";
+  return SeriesStore::validDeviceId(device);
+}
+
+void appendEscaped(std::string& out, const std::string& s) {
+  out += '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    if ((unsigned char)c < 0x20) continue;
+    out += c;
+  }
+  out += '"';
+}
+
+std::string recordToJson(const Record& rec, const std::string& device) {
+  char buf[256];
+  snprintf(buf, sizeof(buf),
+    ",\"ts\":\"%s\",\"trash\":%u,\"temp\":%.1f,\"hum\":%u,\"flame\":%s,\"bat\":%u,"
+    "\"tokens\":%d,\"deps\":%d,\"win\":%s,\"button\":%s,\"rate\":%.1f,\"ttf\":%d,\"time\":%u}",
+    formatTime(rec.tsMs).c_str(), rec.trash, rec.temp10 / 10.0, rec.hum,
+    (rec.flags & RECORD_FLAME) ? "true" : "false", rec.bat, rec.tokens, rec.deps,
+    (rec.flags & RECORD_WIN) ? "true" : "false",
+    (rec.flags & RECORD_BUTTON) ? "true" : "false", rec.rate10 / 10.0, rec.ttf, rec.uptime);
+  std::string out = "{\"id\":";
+  appendEscaped(out, device);
+  return out + buf;
+}
+
+std::string bucketToJson(const Bucket& b) {
+  char buf[320];
+  snprintf(buf, sizeof(buf),
+    "{\"ts\":\"%s\",\"n\":%u,\"trash\":%.1f,\"trashMin\":%.0f,\"trashMax\":%.0f,"
+    "\"temp\":%.1f,\"hum\":%.1f,\"bat\":%.1f,\"tokens\":%d,\"deps\":%d,\"flame\":%s}",
+    formatTime(b.startMs).c_str(), b.count, b.trashAvg, b.trashMin, b.trashMax,
+    b.tempAvg, b.humAvg, b.batAvg, b.tokens, b.deps, b.flame ? "true" : "false");
+  return buf;
+}
+
+// ---------------------------------------------------------------------------
+// Tiempo
+
+bool parseTime(const std::string& s, int64_t& tsMs) {
+  if (s.empty()) return false;
+  if (s.find('-') == std::string::npos || s[0] == '-') {
+    char* e;
+    long long v = strtoll(s.c_str(), &e, 10);
+    if (*e) return false;
+    tsMs = v;
+    return true;
+  }
+
+  struct tm tm;
+  memset(&tm, 0, sizeof(tm));
+  int ms = 0;
+  int consumed = 0;
+  if (sscanf(s.c_str(), "%d-%d-%dT%d:%d:%d%n", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+             &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &consumed) != 6) {
+    return false;
+  }
+  const char* rest = s.c_str() + consumed;
+  if (*rest == '.') {
+    int digits = 0;
+    for (rest++; *rest >= '0' && *rest <= '9'; rest++, digits++) {
+      if (digits < 3) ms = ms * 10 + (*rest - '0');
+    }
+    for (; digits < 3; digits++) ms *= 10;
+  }
+  tm.tm_year -= 1900;
+  tm.tm_mon -= 1;
+  tsMs = (int64_t)timegm(&tm) * 1000 + ms;
+  return true;
+}
+
+std::string formatTime(int64_t tsMs) {
+  time_t sec = (time_t)(tsMs >= 0 ? tsMs / 1000 : (tsMs - 999) / 1000);
+  int ms = (int)(tsMs - (int64_t)sec * 1000);
+  struct tm tm;
+  gmtime_r(&sec, &tm);
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
+           tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, ms);
+  return buf;
+}
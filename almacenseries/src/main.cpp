@@ -0,0 +1,261 @@
+// almacen: CLI del almacén de series temporales.
+//
+//   almacen <dir> import <data.json>
+//   almacen <dir> latest
+//   almacen <dir> since <T> [limite]
+//   almacen <dir> range <dispositivo> <desde> <hasta> <intervalo_s>
+//   almacen <dir> compact <anterior_a> <resolucion_s>
+//   almacen <dir> stats
+//   almacen <dir> serve
+//
+// Los tiempos se aceptan en ISO 8601 UTC o en ms desde epoch.
+//
+// "serve" atiende por stdin/stdout una orden por línea y responde una línea
+// JSON por orden; es lo que usa interfazweb/server.cjs:
+//   A <ts_ms> <json>                       añadir muestra
+//   L                                      último valor por dispositivo
+//   S <ts_ms> <limite>                     muestras desde ts
+//   R <dispositivo> <desde> <hasta> <ms>   rango submuestreado
+
+#include <codec.h>
+#include <store.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static std::string latestJson(const SeriesStore& store) {
+  std::string out = "{";
+  bool first = true;
+  for (size_t i = 0; i < store.deviceCount(); i++) {
+    if (!store.hasLatest((uint16_t)i)) continue;
+    if (!first) out += ",";
+    first = false;
+    appendEscaped(out, store.deviceName((uint16_t)i));
+    out += ":";
+    out += recordToJson(store.latest()[i], store.deviceName((uint16_t)i));
+  }
+  return out + "}";
+}
+
+static std::string recordsJson(const SeriesStore& store, const std::vector<Record>& recs) {
+  std::string out = "[";
+  for (size_t i = 0; i < recs.size(); i++) {
+    if (i) out += ",";
+    out += recordToJson(recs[i], store.deviceName(recs[i].device));
+  }
+  return out + "]";
+}
+
+static std::string bucketsJson(const std::vector<Bucket>& buckets) {
+  std::string out = "[";
+  for (size_t i = 0; i < buckets.size(); i++) {
+    if (i) out += ",";
+    out += bucketToJson(buckets[i]);
+  }
+  return out + "]";
+}
+
+static std::string errorJson(const std::string& msg) {
+  std::string out = "{\"ok\":false,\"error\":\"";
+  for (char c : msg) {
+    if (c == '"' || c == '\\') out += '\\';
+    if ((unsigned char)c >= 0x20) out += c;
+  }
+  return out + "\"}";
+}
+
+static int cmdImport(SeriesStore& store, const char* path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    fprintf(stderr, "No se pudo abrir %s\n", path);
+    return 1;
+  }
+  std::stringstream ss;
+  ss << in.rdbuf();
+
+  JsonValue root;
+  std::string err;
+  if (!parseJson(ss.str(), root, &err) || root.type != JsonValue::JSON_OBJECT) {
+    fprintf(stderr, "%s: JSON no válido: %s\n", path, err.c_str());
+    return 1;
+  }
+
+  // data.json: { "<ISO>": {muestra}, ... } — se ordena por tiempo antes de añadir
+  std::vector<std::pair<int64_t, const JsonValue*>> entries;
+  size_t skipped = 0;
+  for (const auto& m : root.members) {
+    int64_t ts;
+    if (m.second.type != JsonValue::JSON_OBJECT || !parseTime(m.first, ts)) {
+      skipped++;
+      continue;
+    }
+    entries.emplace_back(ts, &m.second);
+  }
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const auto& a, const auto& b) { return a.first < b.first; });
+
+  size_t imported = 0;
+  for (const auto& e : entries) {
+    Record r;
+    std::string device;
+    if (!recordFromJson(*e.second, e.first, r, device)) {
+      skipped++;
+      continue;
+    }
+    if (!store.append(r, device, &err)) {
+      fprintf(stderr, "Error: %s\n", err.c_str());
+      return 1;
+    }
+    imported++;
+  }
+  printf("Importadas %zu muestras (%zu descartadas), %zu dispositivos\n",
+         imported, skipped, store.deviceCount());
+  return 0;
+}
+
+static int cmdServe(SeriesStore& store) {
+  std::string line;
+  while (std::getline(std::cin, line)) {
+    if (line.empty()) continue;
+    std::string out;
+    std::string err;
+    char op = line[0];
+    const char* args = line.c_str() + 1;
+
+    if (op == 'A') {
+      long long ts;
+      int consumed = 0;
+      JsonValue obj;
+      if (sscanf(args, "%lld %n", &ts, &consumed) < 1 || consumed == 0) {
+        out = errorJson("A <ts_ms> <json>");
+      } else if (!parseJson(args + consumed, obj, &err) || obj.type != JsonValue::JSON_OBJECT) {
+        out = errorJson("JSON no válido: " + err);
+      } else {
+        Record r;
+        std::string device;
+        if (!recordFromJson(obj, ts, r, device)) {
+          out = errorJson("Id de dispositivo no válido");
+        } else {
+          out = store.append(r, device, &err) ? "{\"ok\":true}" : errorJson(err);
+        }
+      }
+    } else if (op == 'L') {
+      out = latestJson(store);
+    } else if (op == 'S') {
+      long long ts;
+      unsigned long long limit = 1000;
+      if (sscanf(args, "%lld %llu", &ts, &limit) < 1) {
+        out = errorJson("S <ts_ms> <limite>");
+      } else {
+        std::vector<Record> recs;
+        store.since(ts, limit, recs);
+        out = recordsJson(store, recs);
+      }
+    } else if (op == 'R') {
+      char dev[128];
+      long long from, to, bucket;
+      if (sscanf(args, "%127s %lld %lld %lld", dev, &from, &to, &bucket) != 4) {
+        out = errorJson("R <dispositivo> <desde> <hasta> <ms>");
+      } else if (store.deviceIndex(dev) < 0) {
+        out = "[]";
+      } else {
+        std::vector<Bucket> buckets;
+        store.range(store.deviceIndex(dev), from, to, bucket, buckets);
+        out = bucketsJson(buckets);
+      }
+    } else {
+      out = errorJson("Orden desconocida");
+    }
+    fputs(out.c_str(), stdout);
+    fputc('\n', stdout);
+    fflush(stdout);
+  }
+  return 0;
+}
+
+static void usage() {
+  fprintf(stderr,
+    "Uso: almacen <dir> import <data.json>\n"
+    "     almacen <dir> latest\n"
+    "     almacen <dir> since <T> [limite]\n"
+    "     almacen <dir> range <dispositivo> <desde> <hasta> <intervalo_s>\n"
+    "     almacen <dir> compact <anterior_a> <resolucion_s>\n"
+    "     almacen <dir> stats\n"
+    "     almacen <dir> serve\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    usage();
+    return 1;
+  }
+  std::string cmd = argv[2];
+  SeriesStore store(argv[1]);
+  std::string err;
+  if (!store.open(&err)) {
+    fprintf(stderr, "Error: %s\n", err.c_str());
+    return 1;
+  }
+
+  if (cmd == "import" && argc == 4) return cmdImport(store, argv[3]);
+  if (cmd == "serve" && argc == 3) return cmdServe(store);
+
+  if (cmd == "latest" && argc == 3) {
+    puts(latestJson(store).c_str());
+    return 0;
+  }
+  if (cmd == "since" && (argc == 4 || argc == 5)) {
+    int64_t ts;
+    if (!parseTime(argv[3], ts)) {
+      usage();
+      return 1;
+    }
+    std::vector<Record> recs;
+    store.since(ts, argc == 5 ? strtoull(argv[4], nullptr, 10) : SIZE_MAX, recs);
+    puts(recordsJson(store, recs).c_str());
+    return 0;
+  }
+  if (cmd == "range" && argc == 7) {
+    int64_t from, to;
+    int dev = store.deviceIndex(argv[3]);
+    if (!parseTime(argv[4], from) || !parseTime(argv[5], to)) {
+      usage();
+      return 1;
+    }
+    std::vector<Bucket> buckets;
+    if (dev >= 0) store.range(dev, from, to, (int64_t)(atof(argv[6]) * 1000), buckets);
+    puts(bucketsJson(buckets).c_str());
+    return 0;
+  }
+  if (cmd == "compact" && argc == 5) {
+    int64_t before;
+    if (!parseTime(argv[3], before)) {
+      usage();
+      return 1;
+    }
+    uint64_t n = store.recordCount();
+    if (!store.compact(before, (int64_t)(atof(argv[4]) * 1000), &err)) {
+      fprintf(stderr, "Error: %s\n", err.c_str());
+      return 1;
+    }
+    printf("Compactado: %llu -> %llu registros\n",
+           (unsigned long long)n, (unsigned long long)store.recordCount());
+    return 0;
+  }
+  if (cmd == "stats" && argc == 3) {
+    printf("segmentos=%zu registros=%llu dispositivos=%zu\n", store.segmentCount(),
+           (unsigned long long)store.recordCount(), store.deviceCount());
+    return 0;
+  }
+
+  usage();
+  return 1;
+}
@@ -0,0 +1,513 @@
+#include <store.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+
+static const uint32_t READ_CHUNK = 4096;   // Registros por lectura (128 KB)
+static const char INDEX_MAGIC[4] = {'S', 'I', 'D', 'X'};
+
+static bool setErr(std::string* err, const std::string& msg) {
+  if (err) *err = msg + (errno ? std::string(": ") + strerror(errno) : std::string());
+  return false;
+}
+
+static bool readAt(int fd, void* buf, size_t len, off_t off) {
+  char* p = (char*)buf;
+  while (len) {
+    ssize_t r = pread(fd, p, len, off);
+    if (r <= 0) return false;
+    p += r;
+    len -= r;
+    off += r;
+  }
+  return true;
+}
+
+static bool writeAll(int fd, const void* buf, size_t len) {
+  const char* p = (const char*)buf;
+  while (len) {
+    ssize_t w = write(fd, p, len);
+    if (w <= 0) return false;
+    p += w;
+    len -= w;
+  }
+  return true;
+}
+
+uint32_t SeriesStore::checksum(const Record& rec) {
+  const uint8_t* p = (const uint8_t*)&rec;
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < offsetof(Record, checksum); i++) {
+    h ^= p[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+SeriesStore::SeriesStore(const std::string& dir, uint32_t segmentRecords)
+  : dir(dir), segmentRecords(segmentRecords), activeFd(-1), lastTs(0) {
+  if (this->segmentRecords < INDEX_STRIDE) this->segmentRecords = INDEX_STRIDE;
+}
+
+SeriesStore::~SeriesStore() {
+  close();
+}
+
+std::string SeriesStore::segmentPath(uint32_t seq, const char* ext) const {
+  char name[32];
+  snprintf(name, sizeof(name), "/seg-%06u%s", seq, ext);
+  return dir + name;
+}
+
+bool SeriesStore::open(std::string* err) {
+  errno = 0;
+  if (mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST) return setErr(err, "No se pudo crear " + dir);
+  errno = 0;
+
+  finishPendingCompaction();
+  if (!loadDevices(err)) return false;
+
+  std::vector<uint32_t> seqs;
+  DIR* d = opendir(dir.c_str());
+  if (!d) return setErr(err, "No se pudo abrir " + dir);
+  while (dirent* e = readdir(d)) {
+    unsigned seq;
+    char tail[8];
+    if (sscanf(e->d_name, "seg-%6u.%7s", &seq, tail) == 2 && strcmp(tail, "log") == 0) seqs.push_back(seq);
+  }
+  closedir(d);
+  std::sort(seqs.begin(), seqs.end());
+
+  segments.clear();
+  for (size_t i = 0; i < seqs.size(); i++) {
+    if (!loadSegment(seqs[i], i + 1 == seqs.size(), err)) return false;
+  }
+  lastTs = segments.empty() ? 0 : segments.back().maxTs;
+  rebuildLatest();
+  return true;
+}
+
+void SeriesStore::close() {
+  if (activeFd >= 0) {
+    fsync(activeFd);
+    ::close(activeFd);
+    activeFd = -1;
+  }
+}
+
+bool SeriesStore::loadDevices(std::string* err) {
+  devices.clear();
+  deviceIds.clear();
+  std::ifstream in(dir + "/devices.txt");
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty()) continue;
+    deviceIds[line] = (int)devices.size();
+    devices.push_back(line);
+  }
+  (void)err;
+  return true;
+}
+
+int SeriesStore::deviceIndex(const std::string& name) const {
+  auto it = deviceIds.find(name);
+  return it == deviceIds.end() ? -1 : it->second;
+}
+
+bool SeriesStore::validDeviceId(const std::string& name) {
+  if (name.empty()) return false;
+  for (char c : name) {
+    if (c == '"' || c == '\\' || (unsigned char)c < 0x20) return false;
+  }
+  return true;
+}
+
+int SeriesStore::addDevice(const std::string& name, std::string* err) {
+  int idx = deviceIndex(name);
+  if (idx >= 0) return idx;
+  if (devices.size() >= 0xFFFF || !validDeviceId(name)) {
+    setErr(err, "Id de dispositivo no válido: " + name);
+    return -1;
+  }
+  std::ofstream out(dir + "/devices.txt", std::ios::app);
+  out << name << "\n";
+  out.flush();
+  if (!out) {
+    setErr(err, "No se pudo escribir devices.txt");
+    return -1;
+  }
+  idx = (int)devices.size();
+  deviceIds[name] = idx;
+  devices.push_back(name);
+  latestCache.push_back(Record());
+  latestValid.push_back(false);
+  return idx;
+}
+
+bool SeriesStore::loadSegment(uint32_t seq, bool last, std::string* err) {
+  std::string path = segmentPath(seq, ".log");
+  int fd = ::open(path.c_str(), O_RDWR);
+  if (fd < 0) return setErr(err, "No se pudo abrir " + path);
+
+  struct stat st;
+  fstat(fd, &st);
+  Segment seg;
+  seg.seq = seq;
+  seg.count = st.st_size / sizeof(Record);
+  seg.minTs = seg.maxTs = 0;
+  seg.sealed = !last;
+
+  // Los segmentos sellados traen su índice; si no cuadra se reconstruye
+  bool indexed = false;
+  if (seg.sealed) {
+    std::ifstream idx(segmentPath(seq, ".idx"), std::ios::binary);
+    char magic[4];
+    uint64_t count;
+    uint32_t n;
+    if (idx.read(magic, 4) && memcmp(magic, INDEX_MAGIC, 4) == 0 &&
+        idx.read((char*)&count, 8) && count == seg.count &&
+        idx.read((char*)&seg.minTs, 8) && idx.read((char*)&seg.maxTs, 8) &&
+        idx.read((char*)&n, 4) && n == (count + INDEX_STRIDE - 1) / INDEX_STRIDE) {
+      seg.index.resize(n);
+      indexed = (bool)idx.read((char*)seg.index.data(), n * sizeof(int64_t));
+    }
+  }
+
+  if (!indexed) {
+    // Recorrido completo: reconstruye el índice y corta la cola si hay un
+    // registro a medio escribir o corrupto (sólo en el segmento activo).
+    seg.index.clear();
+    std::vector<Record> buf(READ_CHUNK);
+    uint64_t valid = 0;
+    bool stop = false;
+    for (uint64_t pos = 0; pos < seg.count && !stop; pos += READ_CHUNK) {
+      uint64_t n = std::min<uint64_t>(READ_CHUNK, seg.count - pos);
+      if (!readAt(fd, buf.data(), n * sizeof(Record), pos * sizeof(Record))) break;
+      for (uint64_t i = 0; i < n; i++) {
+        const Record& r = buf[i];
+        if (r.checksum != checksum(r) || (valid && r.tsMs < seg.maxTs)) {
+          stop = true;
+          break;
+        }
+        if (valid % INDEX_STRIDE == 0) seg.index.push_back(r.tsMs);
+        if (!valid) seg.minTs = r.tsMs;
+        seg.maxTs = r.tsMs;
+        valid++;
+      }
+    }
+    if (valid != seg.count || (uint64_t)st.st_size != seg.count * sizeof(Record)) {
+      if (!last) {
+        ::close(fd);
+        errno = 0;
+        return setErr(err, "Segmento sellado corrupto: " + path);
+      }
+      fprintf(stderr, "%s: truncado a %llu registros\n", path.c_str(), (unsigned long long)valid);
+      if (ftruncate(fd, valid * sizeof(Record)) < 0) {
+        ::close(fd);
+        return setErr(err, "No se pudo truncar " + path);
+      }
+      seg.count = valid;
+    }
+    if (seg.sealed) writeIndex(seg);
+  }
+
+  if (last) {
+    lseek(fd, 0, SEEK_END);
+    activeFd = fd;
+  } else {
+    ::close(fd);
+  }
+  segments.push_back(seg);
+  return true;
+}
+
+bool SeriesStore::writeIndex(const Segment& seg) const {
+  std::string tmp = segmentPath(seg.seq, ".idx.tmp");
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    uint32_t n = (uint32_t)seg.index.size();
+    out.write(INDEX_MAGIC, 4);
+    out.write((const char*)&seg.count, 8);
+    out.write((const char*)&seg.minTs, 8);
+    out.write((const char*)&seg.maxTs, 8);
+    out.write((const char*)&n, 4);
+    out.write((const char*)seg.index.data(), n * sizeof(int64_t));
+    if (!out) return false;
+  }
+  return rename(tmp.c_str(), segmentPath(seg.seq, ".idx").c_str()) == 0;
+}
+
+bool SeriesStore::openActive(std::string* err) {
+  uint32_t seq = segments.empty() ? 1 : segments.back().seq + 1;
+  std::string path = segmentPath(seq, ".log");
+  activeFd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (activeFd < 0) return setErr(err, "No se pudo crear " + path);
+
+  Segment seg;
+  seg.seq = seq;
+  seg.count = 0;
+  seg.minTs = seg.maxTs = 0;
+  seg.sealed = false;
+  segments.push_back(seg);
+  return true;
+}
+
+bool SeriesStore::seal(std::string* err) {
+  Segment& seg = segments.back();
+  if (fsync(activeFd) < 0) return setErr(err, "fsync falló");
+  ::close(activeFd);
+  activeFd = -1;
+  seg.sealed = true;
+  if (!writeIndex(seg)) return setErr(err, "No se pudo escribir el índice");
+  return true;
+}
+
+bool SeriesStore::append(Record rec, const std::string& device, std::string* err) {
+  errno = 0;
+  int dev = addDevice(device, err);
+  if (dev < 0) return false;
+
+  if (activeFd >= 0 && segments.back().count >= segmentRecords && !seal(err)) return false;
+  if (activeFd < 0 && !openActive(err)) return false;
+
+  rec.device = (uint16_t)dev;
+  if (rec.tsMs < lastTs) rec.tsMs = lastTs;
+  rec.checksum = checksum(rec);
+  if (!writeAll(activeFd, &rec, sizeof(rec))) return setErr(err, "Error escribiendo registro");
+
+  Segment& seg = segments.back();
+  if (seg.count % INDEX_STRIDE == 0) seg.index.push_back(rec.tsMs);
+  if (seg.count == 0) seg.minTs = rec.tsMs;
+  seg.maxTs = rec.tsMs;
+  seg.count++;
+  lastTs = rec.tsMs;
+
+  latestCache[dev] = rec;
+  latestValid[dev] = true;
+  return true;
+}
+
+bool SeriesStore::hasLatest(uint16_t device) const {
+  return device < latestValid.size() && latestValid[device];
+}
+
+uint64_t SeriesStore::recordCount() const {
+  uint64_t n = 0;
+  for (const Segment& s : segments) n += s.count;
+  return n;
+}
+
+void SeriesStore::rebuildLatest() {
+  latestCache.assign(devices.size(), Record());
+  latestValid.assign(devices.size(), false);
+
+  // Hacia atrás desde el final hasta encontrar todos los dispositivos;
+  // normalmente basta con el último segmento.
+  size_t missing = devices.size();
+  std::vector<Record> buf(READ_CHUNK);
+  for (size_t s = segments.size(); s-- > 0 && missing;) {
+    const Segment& seg = segments[s];
+    int fd = ::open(segmentPath(seg.seq, ".log").c_str(), O_RDONLY);
+    if (fd < 0) continue;
+    for (uint64_t end = seg.count; end > 0 && missing;) {
+      uint64_t start = end > READ_CHUNK ? end - READ_CHUNK : 0;
+      if (!readAt(fd, buf.data(), (end - start) * sizeof(Record), start * sizeof(Record))) break;
+      for (uint64_t i = end - start; i-- > 0;) {
+        const Record& r = buf[i];
+        if (r.device < devices.size() && !latestValid[r.device]) {
+          latestCache[r.device] = r;
+          latestValid[r.device] = true;
+          if (--missing == 0) break;
+        }
+      }
+      end = start;
+    }
+    ::close(fd);
+  }
+}
+
+size_t SeriesStore::findFirst(const Segment& seg, int64_t tsMs, int fd) const {
+  // Bloque del índice disperso donde puede estar el primer ts >= tsMs
+  size_t j = std::lower_bound(seg.index.begin(), seg.index.end(), tsMs) - seg.index.begin();
+  uint64_t start = j ? (uint64_t)(j - 1) * INDEX_STRIDE : 0;
+  uint64_t n = std::min<uint64_t>(INDEX_STRIDE, seg.count - start);
+  Record buf[INDEX_STRIDE];
+  if (!readAt(fd, buf, n * sizeof(Record), start * sizeof(Record))) return seg.count;
+  for (uint64_t i = 0; i < n; i++) {
+    if (buf[i].tsMs >= tsMs) return start + i;
+  }
+  return start + n;
+}
+
+void SeriesStore::scan(int64_t fromMs, int64_t toMs, size_t limit, int device, std::vector<Record>& out) const {
+  auto it = std::lower_bound(segments.begin(), segments.end(), fromMs,
+                             [](const Segment& s, int64_t t) { return s.count == 0 || s.maxTs < t; });
+  std::vector<Record> buf(READ_CHUNK);
+  bool first = true;
+  for (; it != segments.end(); ++it) {
+    const Segment& seg = *it;
+    if (seg.count == 0) continue;
+    if (seg.minTs > toMs) return;
+    int fd = ::open(segmentPath(seg.seq, ".log").c_str(), O_RDONLY);
+    if (fd < 0) continue;
+    uint64_t pos = first ? findFirst(seg, fromMs, fd) : 0;
+    first = false;
+    for (; pos < seg.count; pos += READ_CHUNK) {
+      uint64_t n = std::min<uint64_t>(READ_CHUNK, seg.count - pos);
+      if (!readAt(fd, buf.data(), n * sizeof(Record), pos * sizeof(Record))) break;
+      for (uint64_t i = 0; i < n; i++) {
+        const Record& r = buf[i];
+        if (r.tsMs > toMs || out.size() >= limit) {
+          ::close(fd);
+          return;
+        }
+        if (device < 0 || r.device == device) out.push_back(r);
+      }
+    }
+    ::close(fd);
+  }
+}
+
+void SeriesStore::since(int64_t tsMs, size_t limit, std::vector<Record>& out) const {
+  scan(tsMs, INT64_MAX, limit, -1, out);
+}
+
+void SeriesStore::range(int device, int64_t fromMs, int64_t toMs, int64_t bucketMs, std::vector<Bucket>& out) const {
+  std::vector<Record> recs;
+  scan(fromMs, toMs, SIZE_MAX, device, recs);
+  if (bucketMs <= 0) bucketMs = 1;
+
+  Bucket* b = nullptr;
+  for (const Record& r : recs) {
+    int64_t start = fromMs + (r.tsMs - fromMs) / bucketMs * bucketMs;
+    if (!b || b->startMs != start) {
+      if (b) {
+        b->trashAvg /= b->count;
+        b->tempAvg /= b->count;
+        b->humAvg /= b->count;
+        b->batAvg /= b->count;
+      }
+      out.push_back(Bucket());
+      b = &out.back();
+      memset(b, 0, sizeof(*b));
+      b->startMs = start;
+      b->trashMin = b->trashMax = r.trash;
+    }
+    b->count++;
+    b->trashAvg += r.trash;
+    b->trashMin = std::min<float>(b->trashMin, r.trash);
+    b->trashMax = std::max<float>(b->trashMax, r.trash);
+    b->tempAvg += r.temp10 / 10.0f;
+    b->humAvg += r.hum;
+    b->batAvg += r.bat;
+    b->tokens = r.tokens;
+    b->deps = r.deps;
+    b->flame = b->flame || (r.flags & RECORD_FLAME);
+  }
+  if (b) {
+    b->trashAvg /= b->count;
+    b->tempAvg /= b->count;
+    b->humAvg /= b->count;
+    b->batAvg /= b->count;
+  }
+}
+
+// La compactación escribe seg-<primero>.log.compact y deja en compact.pending
+// la lista de segmentos que reemplaza. Si se corta a medias, open() la
+// termina (renombrado hecho) o la descarta (renombrado sin hacer).
+void SeriesStore::finishPendingCompaction() {
+  std::ifstream pending(dir + "/compact.pending");
+  if (!pending) return;
+  std::vector<uint32_t> seqs;
+  uint32_t seq;
+  while (pending >> seq) seqs.push_back(seq);
+  pending.close();
+
+  if (!seqs.empty()) {
+    std::string tmp = segmentPath(seqs[0], ".log.compact");
+    if (access(tmp.c_str(), F_OK) == 0) {
+      unlink(tmp.c_str());
+    } else {
+      unlink(segmentPath(seqs[0], ".idx").c_str());
+      for (size_t i = 1; i < seqs.size(); i++) {
+        unlink(segmentPath(seqs[i], ".log").c_str());
+        unlink(segmentPath(seqs[i], ".idx").c_str());
+      }
+    }
+  }
+  unlink((dir + "/compact.pending").c_str());
+}
+
+bool SeriesStore::compact(int64_t olderThanMs, int64_t resolutionMs, std::string* err) {
+  errno = 0;
+  size_t n = 0;
+  while (n < segments.size() && segments[n].sealed && segments[n].maxTs < olderThanMs) n++;
+  if (n == 0) return true;
+  if (resolutionMs <= 0) resolutionMs = 1;
+
+  // Último registro de cada (dispositivo, intervalo)
+  std::map<std::pair<uint16_t, int64_t>, Record> keep;
+  std::vector<Record> buf(READ_CHUNK);
+  for (size_t s = 0; s < n; s++) {
+    const Segment& seg = segments[s];
+    int fd = ::open(segmentPath(seg.seq, ".log").c_str(), O_RDONLY);
+    if (fd < 0) return setErr(err, "No se pudo abrir " + segmentPath(seg.seq, ".log"));
+    for (uint64_t pos = 0; pos < seg.count; pos += READ_CHUNK) {
+      uint64_t c = std::min<uint64_t>(READ_CHUNK, seg.count - pos);
+      if (!readAt(fd, buf.data(), c * sizeof(Record), pos * sizeof(Record))) {
+        ::close(fd);
+        return setErr(err, "Error leyendo " + segmentPath(seg.seq, ".log"));
+      }
+      for (uint64_t i = 0; i < c; i++) keep[{buf[i].device, buf[i].tsMs / resolutionMs}] = buf[i];
+    }
+    ::close(fd);
+  }
+  std::vector<Record> out;
+  out.reserve(keep.size());
+  for (auto& kv : keep) out.push_back(kv.second);
+  std::stable_sort(out.begin(), out.end(), [](const Record& a, const Record& b) { return a.tsMs < b.tsMs; });
+
+  uint32_t firstSeq = segments[0].seq;
+  std::string tmp = segmentPath(firstSeq, ".log.compact");
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return setErr(err, "No se pudo crear " + tmp);
+  bool ok = writeAll(fd, out.data(), out.size() * sizeof(Record)) && fsync(fd) == 0;
+  ::close(fd);
+  if (!ok) {
+    unlink(tmp.c_str());
+    return setErr(err, "Error escribiendo " + tmp);
+  }
+
+  {
+    std::ofstream pending(dir + "/compact.pending", std::ios::trunc);
+    for (size_t i = 0; i < n; i++) pending << segments[i].seq << "\n";
+    if (!pending) return setErr(err, "No se pudo escribir compact.pending");
+  }
+  unlink(segmentPath(firstSeq, ".idx").c_str());
+  if (rename(tmp.c_str(), segmentPath(firstSeq, ".log").c_str()) < 0) {
+    return setErr(err, "No se pudo renombrar " + tmp);
+  }
+  finishPendingCompaction();
+
+  Segment seg;
+  seg.seq = firstSeq;
+  seg.count = out.size();
+  seg.minTs = out.empty() ? 0 : out.front().tsMs;
+  seg.maxTs = out.empty() ? 0 : out.back().tsMs;
+  seg.sealed = true;
+  for (size_t i = 0; i < out.size(); i += INDEX_STRIDE) seg.index.push_back(out[i].tsMs);
+  writeIndex(seg);
+
+  segments.erase(segments.begin(), segments.begin() + n);
+  segments.insert(segments.begin(), seg);
+  return true;
+}
@@ -0,0 +1,28 @@
+#ifndef SHIM_ARDUINO_H
+#define SHIM_ARDUINO_H
+
+// Lo mínimo de Arduino.h para compilar en el host las rutas que se miden.
+// No sustituye al core: sólo lo que usan los headers incluidos en bancopruebas.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "WString.h"
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+
+// Los pines escriben en memoria para que el compilador no elimine las llamadas
+extern volatile uint8_t shimPins[32];
+
+inline void digitalWrite(uint8_t pin, uint8_t val) {
+  shimPins[pin & 31] = val;
+}
+
+inline void delayMicroseconds(unsigned int) {}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef SHIM_WSTRING_H
+#define SHIM_WSTRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Modelo de String del core ESP8266 3.x, para que las asignaciones medidas en
+// el host sean las mismas que en la placa: hasta 10 caracteres sin reservar
+// memoria (SSO) y los bloques del heap redondeados a 16 bytes.
+
+class String {
+public:
+  String(const char* cstr = "");
+  String(const String& str);
+  String(String&& str) noexcept;
+  explicit String(char c);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(float value, unsigned char decimalPlaces = 2);
+  explicit String(double value, unsigned char decimalPlaces = 2);
+  ~String();
+
+  String& operator=(const String& rhs);
+  String& operator=(String&& rhs) noexcept;
+  String& operator=(const char* cstr);
+
+  bool reserve(unsigned int size);
+  unsigned int length() const { return len; }
+  unsigned int capacity() const { return heap ? cap : SSO_SIZE - 1; }
+  const char* c_str() const { return heap ? heap : sso; }
+
+  bool concat(const char* cstr, unsigned int length);
+  bool concat(const char* cstr);
+  bool concat(const String& str) { return concat(str.c_str(), str.len); }
+  bool concat(char c) { return concat(&c, 1); }
+
+  String& operator+=(const String& rhs) { concat(rhs); return *this; }
+  String& operator+=(const char* cstr) { concat(cstr); return *this; }
+  String& operator+=(char c) { concat(c); return *this; }
+
+  bool operator==(const char* cstr) const;
+  bool operator==(const String& rhs) const { return *this == rhs.c_str(); }
+
+private:
+  enum { SSO_SIZE = 11 };
+  char* heap = nullptr;
+  uint16_t cap = 0;
+  uint16_t len = 0;
+  char sso[SSO_SIZE] = {0};
+
+  bool changeBuffer(unsigned int maxStrLen);
+  char* wbuffer() { return heap ? heap : sso; }
+  void assign(const char* cstr, unsigned int length);
+  void invalidate();
+};
+
+// Como el core: el resultado de una suma temporal se reutiliza en vez de copiarse
+String operator+(const String& lhs, const String& rhs);
+String operator+(const String& lhs, const char* rhs);
+String operator+(const char* lhs, const String& rhs);
+String operator+(String&& lhs, const String& rhs);
+String operator+(String&& lhs, const char* rhs);
+
+#endif
@@ -0,0 +1,316 @@
+// Micro-benchmarks de las rutas calientes del firmware, compiladas en el host.
+//
+// Se miden las mismas funciones que usan las placas (headers de
+// esp8266principal/include), no copias. Para cada
+// caso se reporta ns/op, asignaciones/op y bytes/op y se compara con
+// baseline.txt: si algo empeora más que el umbral, el programa sale con 1.
+//
+// Los tiempos dependen de la máquina; las asignaciones no. Con --no-time sólo
+// se comparan asignaciones y bytes (lo que conviene en CI).
+//
+// decodeLine() de la pantalla no está: su referencia tiene que grabarse con
+// ArduinoJson 7 real (pio run -e native, --update) y aún no se ha hecho.
+
+#include <Arduino.h>
+#include <telemetry.h>
+#include <serialstatus.h>
+#include <calibration.h>
+#include <stepper.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// ---------------------------------------------------------------------------
+// Conteo de asignaciones: se reemplaza malloc de glibc. Cuenta también
+// operator new (que llama a malloc).
+
+extern "C" void* __libc_malloc(size_t);
+extern "C" void* __libc_calloc(size_t, size_t);
+extern "C" void* __libc_realloc(void*, size_t);
+extern "C" void __libc_free(void*);
+
+static bool countAllocs = false;
+static uint64_t allocCount = 0;
+static uint64_t allocBytes = 0;
+
+extern "C" void* malloc(size_t n) {
+  if (countAllocs) {
+    allocCount++;
+    allocBytes += n;
+  }
+  return __libc_malloc(n);
+}
+
+extern "C" void* calloc(size_t n, size_t size) {
+  if (countAllocs) {
+    allocCount++;
+    allocBytes += n * size;
+  }
+  return __libc_calloc(n, size);
+}
+
+// Crecer un bloque cuenta como una asignación del tamaño nuevo
+extern "C" void* realloc(void* p, size_t n) {
+  if (countAllocs && n) {
+    allocCount++;
+    allocBytes += n;
+  }
+  return __libc_realloc(p, n);
+}
+
+extern "C" void free(void* p) {
+  __libc_free(p);
+}
+
+// Impide que el compilador descarte un resultado que no se usa
+template <typename T>
+static inline void keep(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// ---------------------------------------------------------------------------
+// Casos
+
+struct BenchPins {
+  static constexpr uint8_t MOTOR_PIN1 = 16;
+  static constexpr uint8_t MOTOR_PIN2 = 2;
+  static constexpr uint8_t MOTOR_PIN3 = 15;
+  static constexpr uint8_t MOTOR_PIN4 = 3;
+};
+
+static SensorData sample() {
+  SensorData d;
+  d.trashLevel = 63.4f;
+  d.temperature = 24.7f;
+  d.humidity = 58.2f;
+  d.flameDetected = false;
+  d.batteryLevel = 81.5f;
+  d.userTokens = 1250;
+  d.dailyDeposits = 17;
+  d.windowOpen = false;
+  d.fillRate = 2.3f;
+  d.timeToFull = 57600;
+  return d;
+}
+
+static SensorData firmwareData = sample();
+static uint32_t counter = 0;
+
+// sendDataToSerial(): String concatenado, cada 2 s
+static void benchSerialStatus() {
+  firmwareData.userTokens = counter++ & 0xfff;
+  String json = serialStatusJson(firmwareData, true, 86400 + counter);
+  keep(json.length());
+}
+
+// sendDataToWeb(): snprintf a buffer en pila
+static void benchWebTelemetry() {
+  char json[TELEMETRY_JSON_MAX];
+  firmwareData.userTokens = counter++ & 0xfff;
+  int len = formatWebTelemetry(json, sizeof(json), "ESP8266_BASURA_01", firmwareData, false, 86400 + counter);
+  keep(len);
+}
+
+// readUltrasonicSensor(): eco (us) a nivel, barriendo todo el rango útil
+static void benchUltrasonicLevel() {
+  long duration = 100 + (counter++ % 11700);
+  float level = distanceToLevel(echoToCm(duration), 5, 33, 2, 200);
+  keep(level);
+}
+
+// readBatteryLevel(): ADC a %
+static void benchBatteryPercent() {
+  int reading = counter++ & 1023;
+  float pct = adcToBatteryPercent(reading, 3300, 121, 10000, 12600);
+  keep(pct);
+}
+
+// stepMotor(): fase siguiente y escritura de las 4 bobinas
+static int motorPhase = 0;
+static void benchStepperStep() {
+  motorPhase = stepperNextPhase(motorPhase, (counter++ & 512) == 0);
+  stepperWrite<BenchPins>(motorPhase);
+}
+
+struct Bench {
+  const char* name;
+  void (*run)();
+};
+
+static const Bench BENCHES[] = {
+  {"serial_status_json", benchSerialStatus},
+  {"web_telemetry_json", benchWebTelemetry},
+  {"ultrasonic_level", benchUltrasonicLevel},
+  {"battery_percent", benchBatteryPercent},
+  {"stepper_step", benchStepperStep},
+};
+
+// ---------------------------------------------------------------------------
+// Medición
+
+struct Result {
+  double nsPerOp = 0;
+  double allocsPerOp = 0;
+  double bytesPerOp = 0;
+};
+
+#define BATCH_MIN_MS 20      // Cada lote dura al menos esto
+#define BATCHES 9            // Se toma el mejor lote
+#define ALLOC_ITERATIONS 1000
+
+static double timeBatch(void (*run)(), uint64_t iterations) {
+  Clock::time_point start = Clock::now();
+  for (uint64_t i = 0; i < iterations; i++) run();
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+static Result measure(const Bench& b, bool timed) {
+  Result r;
+
+  // Calentamiento y conteo de asignaciones con un número fijo de iteraciones
+  for (int i = 0; i < 100; i++) b.run();
+  allocCount = 0;
+  allocBytes = 0;
+  countAllocs = true;
+  for (int i = 0; i < ALLOC_ITERATIONS; i++) b.run();
+  countAllocs = false;
+  r.allocsPerOp = (double)allocCount / ALLOC_ITERATIONS;
+  r.bytesPerOp = (double)allocBytes / ALLOC_ITERATIONS;
+
+  if (!timed) return r;
+
+  uint64_t iterations = 1000;
+  while (timeBatch(b.run, iterations) < BATCH_MIN_MS * 1e6) iterations *= 2;
+  double best = 0;
+  for (int i = 0; i < BATCHES; i++) {
+    double ns = timeBatch(b.run, iterations) / iterations;
+    if (i == 0 || ns < best) best = ns;
+  }
+  r.nsPerOp = best;
+  return r;
+}
+
+// ---------------------------------------------------------------------------
+// Baseline: una línea por caso, "nombre ns/op allocs/op bytes/op"
+
+static std::map<std::string, Result> loadBaseline(const char* path) {
+  std::map<std::string, Result> out;
+  FILE* f = fopen(path, "r");
+  if (!f) return out;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] == '#' || line[0] == '\n') continue;
+    char name[64];
+    Result r;
+    if (sscanf(line, "%63s %lf %lf %lf", name, &r.nsPerOp, &r.allocsPerOp, &r.bytesPerOp) == 4) {
+      out[name] = r;
+    }
+  }
+  fclose(f);
+  return out;
+}
+
+static bool saveBaseline(const char* path, const std::map<std::string, Result>& results) {
+  FILE* f = fopen(path, "w");
+  if (!f) return false;
+  fprintf(f, "# nombre ns/op allocs/op bytes/op  (bancopruebas --update)\n");
+  for (const Bench& b : BENCHES) {
+    auto it = results.find(b.name);
+    if (it == results.end()) continue;
+    fprintf(f, "%s %.2f %.2f %.2f\n", b.name, it->second.nsPerOp, it->second.allocsPerOp, it->second.bytesPerOp);
+  }
+  fclose(f);
+  return true;
+}
+
+struct Config {
+  std::string baseline = "baseline.txt";
+  double threshold = 0.25;        // Tolerancia de tiempo (25 %)
+  double allocThreshold = 0.05;   // Tolerancia de bytes (5 %); asignaciones exactas
+  std::string filter;
+  bool update = false;
+  bool timed = true;
+};
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+    "Uso: %s [opciones]\n"
+    "  --baseline F      archivo de referencia (baseline.txt)\n"
+    "  --threshold X     empeoramiento de ns/op tolerado (0.25 = 25%%)\n"
+    "  --filter S        sólo los casos cuyo nombre contiene S\n"
+    "  --no-time         no medir tiempos, sólo asignaciones\n"
+    "  --update          reescribir la referencia con esta medición\n", prog);
+}
+
+int main(int argc, char** argv) {
+  Config cfg;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--update") { cfg.update = true; continue; }
+    if (a == "--no-time") { cfg.timed = false; continue; }
+    if (i + 1 >= argc) { usage(argv[0]); return 1; }
+    const char* v = argv[++i];
+    if (a == "--baseline") cfg.baseline = v;
+    else if (a == "--threshold") cfg.threshold = atof(v);
+    else if (a == "--filter") cfg.filter = v;
+    else { usage(argv[0]); return 1; }
+  }
+  if (cfg.update && !cfg.timed) {
+    fprintf(stderr, "--update necesita medir tiempos\n");
+    return 1;
+  }
+
+  std::map<std::string, Result> baseline = loadBaseline(cfg.baseline.c_str());
+  std::map<std::string, Result> results = baseline;
+
+  printf("%-20s %10s %10s %10s %10s  %s\n", "caso", "ns/op", "base", "allocs/op", "bytes/op", "estado");
+  int regressions = 0;
+  int missing = 0;
+  for (const Bench& b : BENCHES) {
+    if (!cfg.filter.empty() && !strstr(b.name, cfg.filter.c_str())) continue;
+    Result r = measure(b, cfg.timed);
+    results[b.name] = r;
+
+    const char* status = "ok";
+    auto it = baseline.find(b.name);
+    if (it == baseline.end()) {
+      status = cfg.update ? "nuevo" : "SIN REFERENCIA";
+      missing++;
+    } else {
+      const Result& base = it->second;
+      bool slower = cfg.timed && r.nsPerOp > base.nsPerOp * (1 + cfg.threshold);
+      bool moreAllocs = r.allocsPerOp > base.allocsPerOp + 0.005 ||
+                        r.bytesPerOp > base.bytesPerOp * (1 + cfg.allocThreshold) + 0.5;
+      if (slower || moreAllocs) {
+        status = moreAllocs ? "REGRESION (memoria)" : "REGRESION (tiempo)";
+        regressions++;
+      }
+    }
+    char ns[16] = "-";
+    char baseNs[16] = "-";
+    if (cfg.timed) snprintf(ns, sizeof(ns), "%.2f", r.nsPerOp);
+    if (it != baseline.end()) snprintf(baseNs, sizeof(baseNs), "%.2f", it->second.nsPerOp);
+    printf("%-20s %10s %10s %10.2f %10.2f  %s\n", b.name, ns, baseNs, r.allocsPerOp, r.bytesPerOp, status);
+  }
+
+  if (cfg.update) {
+    if (!saveBaseline(cfg.baseline.c_str(), results)) {
+      fprintf(stderr, "No se pudo escribir %s\n", cfg.baseline.c_str());
+      return 1;
+    }
+    printf("Referencia actualizada: %s\n", cfg.baseline.c_str());
+    return 0;
+  }
+  if (missing) printf("%d caso(s) sin referencia en %s (--update)\n", missing, cfg.baseline.c_str());
+  if (regressions) printf("%d caso(s) empeoraron respecto a %s\n", regressions, cfg.baseline.c_str());
+  return regressions || missing ? 1 : 0;
+}
@@ -0,0 +1,177 @@
+// Implementación del modelo de String (shim/WString.h)
+
+#include <Arduino.h>
+
+#include <stdio.h>
+#include <utility>
+
+volatile uint8_t shimPins[32];
+
+String::String(const char* cstr) {
+  assign(cstr, strlen(cstr));
+}
+
+String::String(const String& str) {
+  assign(str.c_str(), str.len);
+}
+
+String::String(String&& str) noexcept {
+  *this = std::move(str);
+}
+
+String::String(char c) {
+  assign(&c, 1);
+}
+
+// Como itoa()/ltoa() del core: la conversión va a un buffer y luego se copia
+String::String(int value, unsigned char base) : String((long)value, base) {}
+String::String(unsigned int value, unsigned char base) : String((unsigned long)value, base) {}
+
+String::String(long value, unsigned char base) {
+  char buf[2 + 8 * sizeof(long)];
+  snprintf(buf, sizeof(buf), base == 16 ? "%lx" : "%ld", value);
+  assign(buf, strlen(buf));
+}
+
+String::String(unsigned long value, unsigned char base) {
+  char buf[1 + 8 * sizeof(unsigned long)];
+  snprintf(buf, sizeof(buf), base == 16 ? "%lx" : "%lu", value);
+  assign(buf, strlen(buf));
+}
+
+String::String(float value, unsigned char decimalPlaces) : String((double)value, decimalPlaces) {}
+
+// dtostrf(value, decimalPlaces + 2, decimalPlaces, buf)
+String::String(double value, unsigned char decimalPlaces) {
+  char buf[33];
+  snprintf(buf, sizeof(buf), "%*.*f", decimalPlaces + 2, decimalPlaces, value);
+  assign(buf, strlen(buf));
+}
+
+String::~String() {
+  free(heap);
+}
+
+String& String::operator=(const String& rhs) {
+  if (this != &rhs) assign(rhs.c_str(), rhs.len);
+  return *this;
+}
+
+String& String::operator=(String&& rhs) noexcept {
+  if (this == &rhs) return *this;
+  free(heap);
+  heap = rhs.heap;
+  cap = rhs.cap;
+  len = rhs.len;
+  memcpy(sso, rhs.sso, SSO_SIZE);
+  rhs.heap = nullptr;
+  rhs.cap = 0;
+  rhs.len = 0;
+  rhs.sso[0] = 0;
+  return *this;
+}
+
+String& String::operator=(const char* cstr) {
+  assign(cstr, strlen(cstr));
+  return *this;
+}
+
+void String::invalidate() {
+  free(heap);
+  heap = nullptr;
+  cap = 0;
+  len = 0;
+  sso[0] = 0;
+}
+
+bool String::changeBuffer(unsigned int maxStrLen) {
+  if (maxStrLen < SSO_SIZE) {
+    if (heap) {
+      memcpy(sso, heap, len + 1 < SSO_SIZE ? len + 1 : SSO_SIZE);
+      free(heap);
+      heap = nullptr;
+      cap = 0;
+    }
+    return true;
+  }
+  size_t newSize = (maxStrLen + 16) & ~0xf;
+  if (newSize > 0xffff) return false;
+  char* newBuffer;
+  if (heap) {
+    newBuffer = (char*)realloc(heap, newSize);
+  } else {
+    newBuffer = (char*)malloc(newSize);
+    if (newBuffer) memcpy(newBuffer, sso, len + 1);
+  }
+  if (!newBuffer) return false;
+  heap = newBuffer;
+  cap = newSize - 1;
+  return true;
+}
+
+bool String::reserve(unsigned int size) {
+  if (capacity() >= size) return true;
+  return changeBuffer(size);
+}
+
+void String::assign(const char* cstr, unsigned int length) {
+  if (!reserve(length)) {
+    invalidate();
+    return;
+  }
+  len = length;
+  memmove(wbuffer(), cstr, length);
+  wbuffer()[length] = 0;
+}
+
+bool String::concat(const char* cstr, unsigned int length) {
+  if (!length) return true;
+  unsigned int newlen = len + length;
+  if (!reserve(newlen)) return false;
+  memmove(wbuffer() + len, cstr, length);
+  len = newlen;
+  wbuffer()[newlen] = 0;
+  return true;
+}
+
+bool String::concat(const char* cstr) {
+  return concat(cstr, strlen(cstr));
+}
+
+bool String::operator==(const char* cstr) const {
+  return strcmp(c_str(), cstr) == 0;
+}
+
+String operator+(const String& lhs, const String& rhs) {
+  String res;
+  res.reserve(lhs.length() + rhs.length());
+  res += lhs;
+  res += rhs;
+  return res;
+}
+
+String operator+(const String& lhs, const char* rhs) {
+  String res;
+  res.reserve(lhs.length() + strlen(rhs));
+  res += lhs;
+  res += rhs;
+  return res;
+}
+
+String operator+(const char* lhs, const String& rhs) {
+  String res;
+  res.reserve(strlen(lhs) + rhs.length());
+  res += lhs;
+  res += rhs;
+  return res;
+}
+
+String operator+(String&& lhs, const String& rhs) {
+  lhs += rhs;
+  return std::move(lhs);
+}
+
+String operator+(String&& lhs, const char* rhs) {
+  lhs += rhs;
+  return std::move(lhs);
+}
@@ -0,0 +1,44 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <sensors.h>
+
+// Descripción de cada placa: pines y qué driver usa cada sensor.
+// El env de PlatformIO elige la placa con -DBOARD_...; por defecto la original.
+
+// Contenedor original: HC-SR04, DHT11 y batería de 12 V con divisor 12.1:1
+struct HuzzahBasura {
+  static constexpr uint8_t FLAME_PIN = 13;    // D7 - Sensor de llama
+  static constexpr uint8_t IR_PIN = 14;       // D5 - Sensor infrarrojo
+  static constexpr uint8_t BUTTON_PIN = 0;    // D3 - Botón
+
+  static constexpr uint8_t MOTOR_PIN1 = 16;   // D0
+  static constexpr uint8_t MOTOR_PIN2 = 2;    // D4
+  static constexpr uint8_t MOTOR_PIN3 = 15;   // D8
+  static constexpr uint8_t MOTOR_PIN4 = 3;    // RX   - No tenía otro pin, tenía errores
+
+  using Level = UltrasonicLevel<5, 4, 5, 33>;              // D1 trigger, D2 echo; lleno a 5 cm, vacío a 33 cm
+  using Climate = DhtClimate<12, DHT11>;                   // D6
+  using Battery = DividerBattery<A0, 121, 10000, 12600>;   // 10.0 V = 0 %, 12.6 V = 100 %
+};
+
+// Mismo contenedor con DHT22 (rango de -40 a 80 °C, más preciso)
+struct HuzzahDht22 : HuzzahBasura {
+  using Climate = DhtClimate<12, DHT22>;
+};
+
+#if defined(BOARD_HUZZAH_TOF)
+#include <sensors_tof.h>
+
+// VL53L0X en lugar del HC-SR04, en los mismos pines (D2 = SDA, D1 = SCL)
+struct HuzzahTof : HuzzahBasura {
+  using Level = TofLevel<4, 5, 50, 330>;
+};
+typedef HuzzahTof Board;
+#elif defined(BOARD_HUZZAH_DHT22)
+typedef HuzzahDht22 Board;
+#else
+typedef HuzzahBasura Board;
+#endif
+
+#endif
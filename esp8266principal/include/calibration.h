@@ -0,0 +1,38 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+// Conversión de lecturas crudas a unidades, separada de los drivers para
+// poder probarla fuera de la placa. Sin dependencias de Arduino.
+
+// Mismo redondeo que map() del core ESP8266
+inline long mapRounded(long x, long inMin, long inMax, long outMin, long outMax) {
+  const long dividend = outMax - outMin;
+  const long divisor = inMax - inMin;
+  return ((x - inMin) * dividend + divisor / 2) / divisor + outMin;
+}
+
+inline float clampf(float v, float lo, float hi) {
+  return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// Eco del HC-SR04 (us) a distancia (cm), 0.034 cm/us ida y vuelta
+inline float echoToCm(long durationUs) {
+  return (durationUs * 0.034) / 2;
+}
+
+// Distancia a nivel (%): fullCm es la distancia con el contenedor lleno.
+// Fuera de [minCm, maxCm] la medida no es fiable y se devuelve -1.
+inline float distanceToLevel(float cm, long fullCm, long emptyCm, float minCm, float maxCm) {
+  if (cm < minCm || cm > maxCm) return -1;
+  return clampf(mapRounded((long)cm, fullCm, emptyCm, 100, 0), 0, 100);
+}
+
+// ADC (0-1023 sobre refMv) tras un divisor de ratioX10/10 a % de batería
+inline float adcToBatteryPercent(int reading, long refMv, long ratioX10, long emptyMv, long fullMv) {
+  float voltage = (reading / 1024.0) * (refMv / 1000.0);
+  float batteryVoltage = voltage * (ratioX10 / 10.0);
+  float percentage = ((batteryVoltage - emptyMv / 1000.0) / ((fullMv - emptyMv) / 1000.0)) * 100.0;
+  return clampf(percentage, 0, 100);
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <Arduino.h>
+
+// Contadores persistentes de tokens y depósitos.
+//
+// Cada incremento se guarda al momento en la memoria RTC (sobrevive a deep
+// sleep y reset por software, no a un corte de alimentación). A flash sólo se
+// escribe cada COUNTER_COMMIT_INTERVAL, tras COUNTER_COMMIT_DEPOSITS
+// depósitos, al cambiar de día o al bajar la batería. Cada escritura ocupa un slot nuevo de 32 bytes
+// en dos sectores que se alternan, así que un sector se borra una vez cada
+// 2 * COUNTER_SLOTS_PER_SECTOR escrituras y siempre queda una copia válida.
+// Los sectores son los dos últimos del área de FS, que este firmware no usa.
+//
+// Los bloques 0-31 de la memoria RTC de usuario son del comando de copia de
+// eboot: Update.end() los escribe al terminar una OTA. La copia RTC va
+// después, y antes de reiniciar para actualizar countersCommit() la pasa a
+// flash.
+
+#define COUNTER_COMMIT_INTERVAL 600000UL   // 10 min
+#define COUNTER_COMMIT_DEPOSITS 20
+#define COUNTER_SLOTS_PER_SECTOR (SPI_FLASH_SEC_SIZE / 32)
+#define FLASH_ENDURANCE_CYCLES 10000UL      // Ciclos de borrado garantizados por sector
+#define COUNTERS_RTC_BLOCK 32               // Tras el comando de eboot
+#define COUNTERS_RTC_BLOCKS 12              // Reservados (RtcCounters usa 8)
+
+struct PersistentCounters {
+  int32_t tokens;
+  int32_t deposits;          // Del día actual
+  int32_t day;               // año * 1000 + día del año, 0 = sin hora sincronizada
+  uint32_t seq;              // Escrituras a flash desde siempre
+  uint16_t writesToday;
+  uint16_t writesPrevDay;
+};
+
+extern PersistentCounters counters;
+
+void countersBegin();
+void countersAdd(int32_t tokens, int32_t deposits);
+void countersLoop(bool lowBattery);
+void countersCommit();                      // A flash ya si hay cambios (antes de ESP.restart())
+// Imagen OTA rechazada por un rollback (ota.cpp). Va en el mismo slot de flash
+// que los contadores para no olvidarla con un corte de alimentación.
+void countersRejectImage(uint32_t hash);    // Se escribe a flash en el momento
+uint32_t countersRejectedImage();
+uint32_t countersEnduranceDays();
+
+#endif
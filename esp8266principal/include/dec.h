@@ -1,13 +1,15 @@
 void setupWiFi();
 void readSensors();
+void updateSchedule(unsigned long now);
+void checkFlame();
 void checkButton();
 void checkTrashDeposit();
 void closeWindow();
 void sendDataToWeb();
 void sendDataToSerial();
+void sendMetricsToSerial();
+void sendMetricsToWeb();
 void checkCriticalAlerts();
 void checkWiFiStatus();
-float readUltrasonicSensor();
-float readBatteryLevel();
 void openWindow();
 void stepMotor();
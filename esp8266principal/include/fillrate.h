@@ -0,0 +1,31 @@
+#ifndef FILLRATE_H
+#define FILLRATE_H
+
+// Estimador incremental de la velocidad de llenado.
+//
+// Mínimos cuadrados recursivos (RLS) sobre nivel(t) = c + b*(t - ahora), con
+// el origen de tiempo siempre en la última muestra para no perder precisión
+// en float con días de uptime. El olvido es exponencial en tiempo (no por
+// muestra) porque el intervalo de lectura cambia según el scheduler.
+// Sin dependencias de Arduino.
+
+#define FILL_NOISE_VAR 4.0f        // Varianza del ultrasonido (%^2)
+#define FILL_MEMORY_HOURS 1.0f     // Constante de tiempo del olvido
+#define FILL_EMPTY_DROP 20.0f      // Caída (%) que se interpreta como vaciado
+#define FILL_MAX_TTF_S 2592000L    // 30 días: más allá se considera "no se llena"
+
+struct FillRateEstimator {
+  float level;        // c: nivel estimado ahora (%)
+  float rate;         // b: pendiente (%/h)
+  float p00, p01, p11;
+  unsigned long lastMs;
+  bool initialized;
+};
+
+void fillRateReset(FillRateEstimator& e, unsigned long nowMs, float level);
+void fillRateUpdate(FillRateEstimator& e, unsigned long nowMs, float level);
+
+// Segundos hasta llegar al 100 %, o -1 si no sube o tardaría más de 30 días
+long fillRateTimeToFull(const FillRateEstimator& e);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef HTTPSERVER_H
+#define HTTPSERVER_H
+
+#include <Arduino.h>
+#include <telemetry.h>
+
+// Servidor HTTP local para consultar el contenedor sin pasar por el servidor Node:
+//   GET /status   último estado (mismo formato que el POST a /data)
+//   GET /metrics  formatMetrics(), como mucho HTTP_METRICS_MAX_AGE de antigüedad
+//   GET /history  últimas HTTP_HISTORY_LEN muestras, una cada HTTP_HISTORY_INTERVAL
+//
+// Las respuestas (cabeceras incluidas) se serializan una vez en buffers
+// estáticos y sólo se regeneran cuando cambia SensorData o entra una muestra
+// nueva (/status también si su campo "time" ya no es el segundo actual, /metrics
+// si tiene más de HTTP_METRICS_MAX_AGE); cada
+// petición es un único write() del buffer.
+//
+// Para no afectar al motor ni a los sensores se atiende como mucho
+// HTTP_MAX_PER_LOOP peticiones por vuelta de loop() (una si el motor está en
+// marcha) y la lectura de la petición nunca bloquea: si no ha llegado
+// entera se sigue en la siguiente vuelta. stop() espera por defecto hasta
+// 300 ms al ACK del cliente; se acota a HTTP_STOP_WAIT_MS (lwIP sigue
+// enviando lo que quede en cola tras cerrar). Con -DHTTP_SERVER_PORT=0 no se inicia.
+
+#ifndef HTTP_SERVER_PORT
+#define HTTP_SERVER_PORT 80
+#endif
+
+#define HTTP_MAX_PER_LOOP 4
+#define HTTP_REQUEST_TIMEOUT 500UL       // ms para recibir la línea de petición
+#define HTTP_STOP_WAIT_MS 5              // Espera máxima del ACK al cerrar
+#define HTTP_METRICS_MAX_AGE 5000UL
+#define HTTP_HISTORY_LEN 60
+#define HTTP_HISTORY_INTERVAL 60000UL    // 1 muestra/min: la última hora
+
+void httpServerBegin();
+void httpServerLoop(const SensorData& data, bool busy);
+
+#endif
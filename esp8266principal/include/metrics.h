@@ -0,0 +1,53 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+
+// Instrumentación en tiempo de ejecución. Los tiempos se toman con el contador
+// de ciclos del Xtensa (ESP.getCycleCount) y se guardan en histogramas de
+// cubetas fijas: la cubeta k cuenta duraciones < 2^k us (la última acumula el resto).
+
+#define METRIC_HIST_BUCKETS 24    // 2^23 us ~ 8.4 s, cubre el timeout HTTP
+#define METRICS_JSON_MAX 2560     // Peor caso ~2 KB (cuentas de 9-10 cifras en todas las cubetas)
+
+enum MetricId {
+  METRIC_LOOP = 0,
+  METRIC_SENSORS,
+  METRIC_WEB,
+  METRIC_MOTOR,
+  METRIC_SERVER,               // Petición al servidor HTTP local (httpserver.h)
+  METRIC_COUNT
+};
+
+struct LatencyHistogram {
+  uint32_t buckets[METRIC_HIST_BUCKETS];
+  uint32_t count;
+  uint32_t maxUs;
+  uint64_t sumUs;
+};
+
+struct RuntimeMetrics {
+  LatencyHistogram hist[METRIC_COUNT];
+  uint32_t httpRttMs;           // Último POST
+  uint32_t httpErrors;
+  uint32_t wifiReconnects;
+  uint32_t serverRequests;      // Respondidas por el servidor local
+  uint32_t serverDropped;       // Cerradas sin respuesta (timeout)
+  uint64_t loopCycles;          // Ciclos de trabajo de loop() acumulados
+  uint64_t overheadCycles;      // Ciclos gastados dentro de metricsRecord()
+};
+
+extern RuntimeMetrics metrics;
+
+inline uint32_t metricsStart() {
+  return ESP.getCycleCount();
+}
+
+void metricsReset();
+void metricsRecord(MetricId id, uint32_t startCycles);
+void metricsHttpResult(int code, uint32_t rttMs);
+void metricsWiFiReconnect();
+int formatMetrics(char* buf, size_t len);   // Longitud, o -1 si no cabe
+String metricsToJson();                      // Para Serial y el POST (buffer temporal en el heap)
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef OTA_H
+#define OTA_H
+
+#include <Arduino.h>
+
+// Actualizaciones OTA desde el servidor local (interfazweb/server.cjs, /ota).
+//
+// Las imágenes van comprimidas (gzip para el ESP8266, que eboot descomprime
+// al arrancar; zlib para la pantalla) y verificadas por MD5. Si la conexión
+// se corta, la descarga continúa con un "Range" desde el último byte escrito.
+//
+// La imagen de la pantalla se reenvía por la UART en tramas con CRC32. El
+// enlace es de un solo sentido (el pin RX se usa para el motor), así que la
+// imagen se envía OTA_DISPLAY_PASSES veces: la pantalla retoma desde el
+// último byte bueno y descarta lo que ya tiene.
+//
+// Rollback: tras actualizar, la versión nueva queda pendiente hasta pasar
+// OTA_CONFIRM_MS con WiFi. Si antes se reinicia por excepción o watchdog
+// OTA_MAX_FAILED_BOOTS veces, se vuelve a grabar la imagen anterior y el MD5
+// de la rechazada se guarda en flash (counters.h) para no volver a grabarla.
+//
+// Nada empieza con el motor en marcha: la descarga bloquea loop() y las
+// bobinas quedarían alimentadas. Se espera a que pare (stepperRelease()).
+
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "dev"
+#endif
+
+#define OTA_CHECK_INTERVAL 3600000UL   // 1 h
+#define OTA_FIRST_CHECK 30000UL        // Primera comprobación tras arrancar
+#define OTA_CONFIRM_MS 120000UL
+#define OTA_MAX_FAILED_BOOTS 3
+#define OTA_RETRIES 5
+#define OTA_DISPLAY_CHUNK 512
+#define OTA_DISPLAY_PASSES 2
+
+// Trama UART: A5 5A | offset u32 | len u16 | datos | crc32 u32 (little endian).
+// La trama con len 0 y offset = tamaño marca el final de una pasada.
+#define OTA_FRAME_SYNC0 0xA5
+#define OTA_FRAME_SYNC1 0x5A
+
+extern const char* otaURL;
+
+void otaBegin();                    // Al principio de setup()
+void otaLoop(bool wifiConnected, bool motorRunning);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef SENSORS_H
+#define SENSORS_H
+
+#include <Arduino.h>
+#include <DHT.h>
+#include <calibration.h>
+
+// Drivers de sensores como plantillas: pines y calibración son parámetros
+// de la plantilla y todo es estático, así que no hay vtable ni objetos que
+// pasar. Cada tipo de sensor cumple la misma interfaz:
+//
+//   Nivel:    static void begin();  static float read();   // %, -1 si no hay medida
+//   Clima:    static void begin();  static float readTemperature();  static float readHumidity();  // NAN si falla
+//   Batería:  static void begin();  static float read();   // %
+//
+// Una variante nueva es otra plantilla con esa interfaz; la placa la elige
+// en board.h.
+
+// HC-SR04. fullCm/emptyCm: distancia medida con el contenedor lleno/vacío
+template <uint8_t TRIG, uint8_t ECHO, long FULL_CM, long EMPTY_CM, unsigned long TIMEOUT_US = 30000>
+struct UltrasonicLevel {
+  static void begin() {
+    pinMode(TRIG, OUTPUT);
+    pinMode(ECHO, INPUT);
+    digitalWrite(TRIG, LOW);
+  }
+
+  static float read() {
+    digitalWrite(TRIG, LOW);
+    delayMicroseconds(2);
+    digitalWrite(TRIG, HIGH);
+    delayMicroseconds(10);
+    digitalWrite(TRIG, LOW);
+
+    long duration = pulseIn(ECHO, HIGH, TIMEOUT_US);
+    if (duration == 0) {
+      return -1; // Timeout
+    }
+    return distanceToLevel(echoToCm(duration), FULL_CM, EMPTY_CM, 2, 200);
+  }
+};
+
+// DHT11 / DHT22 (TYPE de la librería de Adafruit)
+template <uint8_t PIN, uint8_t TYPE>
+struct DhtClimate {
+  static inline DHT sensor{PIN, TYPE};
+
+  static void begin() {
+    sensor.begin();
+  }
+  static float readTemperature() {
+    return sensor.readTemperature();
+  }
+  static float readHumidity() {
+    return sensor.readHumidity();
+  }
+};
+
+// Divisor resistivo en el ADC. RATIO_X10: Vbat/Vadc * 10 (121 = 12.1:1)
+template <uint8_t PIN, long RATIO_X10, long EMPTY_MV, long FULL_MV, long REF_MV = 3300>
+struct DividerBattery {
+  static_assert(FULL_MV > EMPTY_MV, "FULL_MV debe ser mayor que EMPTY_MV");
+
+  static void begin() {}
+  static float read() {
+    return adcToBatteryPercent(analogRead(PIN), REF_MV, RATIO_X10, EMPTY_MV, FULL_MV);
+  }
+};
+
+#endif
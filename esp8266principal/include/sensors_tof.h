@@ -0,0 +1,36 @@
+#ifndef SENSORS_TOF_H
+#define SENSORS_TOF_H
+
+#include <Wire.h>
+#include <VL53L0X.h>
+#include <sensors.h>
+
+// VL53L0X por I2C (librería pololu/VL53L0X, sólo en los envs que la usan).
+// Mide en mm; fullMm/emptyMm como en UltrasonicLevel.
+template <uint8_t SDA_PIN, uint8_t SCL_PIN, long FULL_MM, long EMPTY_MM>
+struct TofLevel {
+  static inline VL53L0X sensor;
+  static inline bool ready = false;
+
+  static void begin() {
+    Wire.begin(SDA_PIN, SCL_PIN);
+    sensor.setTimeout(50);
+    ready = sensor.init();
+    if (ready) {
+      sensor.startContinuous();
+    } else {
+      Serial.println("VL53L0X no responde");
+    }
+  }
+
+  static float read() {
+    if (!ready) return -1;
+    uint16_t mm = sensor.readRangeContinuousMillimeters();
+    if (sensor.timeoutOccurred()) {
+      return -1;
+    }
+    return distanceToLevel(mm, FULL_MM, EMPTY_MM, 30, 1200);   // Fuera de rango lee 8190
+  }
+};
+
+#endif
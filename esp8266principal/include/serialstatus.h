@@ -0,0 +1,33 @@
+#ifndef SERIALSTATUS_H
+#define SERIALSTATUS_H
+
+#include <Arduino.h>
+#include <telemetry.h>
+
+// La pantalla puede estar en light sleep: despierta con el primer flanco del
+// RX y pierde lo que llega en ~1 ms. Antes de cada línea que importa se manda
+// este relleno (~1.4 ms a 115200), que su lector de líneas ignora.
+#define SERIAL_WAKE_PREAMBLE "\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n"
+
+// Línea de estado que se envía por la UART a la pantalla cada 2 s.
+// Separada de main.cpp para poder medirla en el host (bancopruebas).
+inline String serialStatusJson(const SensorData& d, bool wifi, unsigned long uptimeSec) {
+  String json = "{";
+  json += "\"type\":\"status\",";
+  json += "\"trash\":" + String(d.trashLevel, 1) + ",";
+  json += "\"temp\":" + String(d.temperature, 1) + ",";
+  json += "\"hum\":" + String(d.humidity, 1) + ",";
+  json += "\"flame\":" + String(d.flameDetected ? "true" : "false") + ",";
+  json += "\"bat\":" + String(d.batteryLevel, 1) + ",";
+  json += "\"tokens\":" + String(d.userTokens) + ",";
+  json += "\"deps\":" + String(d.dailyDeposits) + ",";
+  json += "\"win\":" + String(d.windowOpen ? "true" : "false") + ",";
+  json += "\"rate\":" + String(d.fillRate, 1) + ",";
+  json += "\"ttf\":" + String(d.timeToFull) + ",";
+  json += "\"uptime\":" + String(uptimeSec) + ",";
+  json += "\"wifi\":" + String(wifi ? "true" : "false");
+  json += "}";
+  return json;
+}
+
+#endif
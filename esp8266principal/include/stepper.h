@@ -0,0 +1,37 @@
+#ifndef STEPPER_H
+#define STEPPER_H
+
+#include <Arduino.h>
+
+// Secuencia del motor paso a paso (una bobina por paso).
+// B es la descripción de la placa (board.h) con MOTOR_PIN1..4.
+
+static const uint8_t STEP_SEQUENCE[4][4] = {
+  {HIGH, LOW, LOW, LOW},
+  {LOW, HIGH, LOW, LOW},
+  {LOW, LOW, HIGH, LOW},
+  {LOW, LOW, LOW, HIGH}
+};
+
+inline int stepperNextPhase(int phase, bool clockwise) {
+  return clockwise ? (phase + 1) % 4 : (phase - 1 + 4) % 4;
+}
+
+template <typename B>
+inline void stepperWrite(int phase) {
+  digitalWrite(B::MOTOR_PIN1, STEP_SEQUENCE[phase][0]);
+  digitalWrite(B::MOTOR_PIN2, STEP_SEQUENCE[phase][1]);
+  digitalWrite(B::MOTOR_PIN3, STEP_SEQUENCE[phase][2]);
+  digitalWrite(B::MOTOR_PIN4, STEP_SEQUENCE[phase][3]);
+}
+
+// Todas las bobinas apagadas: el motor no consume en reposo
+template <typename B>
+inline void stepperRelease() {
+  digitalWrite(B::MOTOR_PIN1, LOW);
+  digitalWrite(B::MOTOR_PIN2, LOW);
+  digitalWrite(B::MOTOR_PIN3, LOW);
+  digitalWrite(B::MOTOR_PIN4, LOW);
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// Estado de los sensores y formato del payload que se envía a /data.
+// Sin dependencias de Arduino para poder compilarse también en el host
+// (generadorcarga usa este mismo formato para simular contenedores).
+
+struct SensorData {
+  float trashLevel;
+  float temperature;
+  float humidity;
+  bool flameDetected;
+  float batteryLevel;
+  int userTokens;
+  int dailyDeposits;
+  bool windowOpen;
+  float fillRate;     // %/h estimado (fillrate.h)
+  long timeToFull;    // s hasta el 100 %, -1 si no se llena
+};
+
+#define TELEMETRY_JSON_MAX 288
+
+inline int formatWebTelemetry(char* buf, size_t len, const char* deviceId,
+                              const SensorData& d, bool button, unsigned long timeSec) {
+  return snprintf(buf, len,
+    "{\"type\":\"data\",\"id\":\"%s\",\"trash\":%d,\"temp\":%d,\"hum\":%d,"
+    "\"flame\":%s,\"bat\":%d,\"tokens\":%d,\"deps\":%d,\"win\":%s,"
+    "\"button\":%s,\"rate\":%.1f,\"ttf\":%ld,\"time\":%lu}",
+    deviceId,
+    (int)d.trashLevel,
+    (int)d.temperature,
+    (int)d.humidity,
+    d.flameDetected ? "true" : "false",
+    (int)d.batteryLevel,
+    d.userTokens,
+    d.dailyDeposits,
+    d.windowOpen ? "true" : "false",
+    button ? "true" : "false",
+    d.fillRate,
+    d.timeToFull,
+    timeSec);
+}
+
+#endif
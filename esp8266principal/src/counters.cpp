@@ -0,0 +1,200 @@
+#include <Arduino.h>
+#include <time.h>
+#include <counters.h>
+
+extern "C" uint32_t _FS_end;
+
+#define COUNTER_MAGIC 0x4E4B4F54   // "TOKN"
+#define RTC_MAGIC 0x43544352       // "RCTC"
+#define TIME_VALID 1600000000      // Antes de esto la hora no está sincronizada
+
+struct CounterSlot {
+  uint32_t magic;
+  PersistentCounters c;
+  uint32_t rejectedImage;    // countersRejectImage(); 0xFFFFFFFF en slots antiguos
+  uint32_t crc;
+};
+
+struct RtcCounters {
+  uint32_t magic;
+  PersistentCounters c;
+  uint32_t dirty;
+  uint32_t crc;
+};
+
+static_assert(sizeof(CounterSlot) == 32, "CounterSlot debe medir 32 bytes");
+static_assert(sizeof(RtcCounters) <= COUNTERS_RTC_BLOCKS * 4, "RtcCounters no cabe en sus bloques RTC");
+
+PersistentCounters counters;
+
+static uint32_t firstSector;
+static uint8_t activeSector;        // 0 o 1
+static uint16_t nextSlot;           // Siguiente slot libre en el sector activo
+static bool dirty = false;
+static bool lowBatteryCommitted = false;
+static int32_t pendingDeposits = 0;
+static unsigned long lastCommit = 0;
+static uint32_t rejectedImage = 0xFFFFFFFF;
+
+static uint32_t checksum(const void* data, size_t len) {
+  const uint8_t* p = (const uint8_t*)data;
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h ^= p[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static uint32_t slotAddress(uint8_t sector, uint16_t slot) {
+  return (firstSector + sector) * SPI_FLASH_SEC_SIZE + slot * sizeof(CounterSlot);
+}
+
+static void saveRtc() {
+  RtcCounters rtc;
+  rtc.magic = RTC_MAGIC;
+  rtc.c = counters;
+  rtc.dirty = dirty;
+  rtc.crc = checksum(&rtc, offsetof(RtcCounters, crc));
+  ESP.rtcUserMemoryWrite(COUNTERS_RTC_BLOCK, (uint32_t*)&rtc, sizeof(rtc));
+}
+
+// Busca el slot válido más reciente en los dos sectores
+static bool loadFlash() {
+  bool found = false;
+  CounterSlot slot;
+  for (uint8_t s = 0; s < 2; s++) {
+    for (uint16_t i = 0; i < COUNTER_SLOTS_PER_SECTOR; i++) {
+      ESP.flashRead(slotAddress(s, i), (uint32_t*)&slot, sizeof(slot));
+      if (slot.magic == 0xFFFFFFFF) break;   // Resto del sector sin escribir
+      if (slot.magic != COUNTER_MAGIC || slot.crc != checksum(&slot, offsetof(CounterSlot, crc))) continue;
+      if (!found || slot.c.seq > counters.seq) {
+        counters = slot.c;
+        rejectedImage = slot.rejectedImage;
+        activeSector = s;
+        found = true;
+      }
+    }
+  }
+
+  // Siguiente slot libre en el sector activo (se saltan escrituras cortadas)
+  nextSlot = COUNTER_SLOTS_PER_SECTOR;
+  for (uint16_t i = 0; i < COUNTER_SLOTS_PER_SECTOR; i++) {
+    uint32_t magic;
+    ESP.flashRead(slotAddress(activeSector, i), &magic, sizeof(magic));
+    if (magic == 0xFFFFFFFF) {
+      nextSlot = i;
+      break;
+    }
+  }
+  return found;
+}
+
+static void commit() {
+  if (nextSlot >= COUNTER_SLOTS_PER_SECTOR) {
+    // Sector lleno: se pasa al otro; el actual conserva la última copia
+    activeSector ^= 1;
+    ESP.flashEraseSector(firstSector + activeSector);
+    nextSlot = 0;
+  }
+
+  counters.seq++;
+  counters.writesToday++;
+  CounterSlot slot;
+  memset(&slot, 0xFF, sizeof(slot));
+  slot.magic = COUNTER_MAGIC;
+  slot.c = counters;
+  slot.rejectedImage = rejectedImage;
+  slot.crc = checksum(&slot, offsetof(CounterSlot, crc));
+  ESP.flashWrite(slotAddress(activeSector, nextSlot), (uint32_t*)&slot, sizeof(slot));
+  nextSlot++;
+
+  dirty = false;
+  pendingDeposits = 0;
+  lastCommit = millis();
+  saveRtc();
+}
+
+void countersBegin() {
+  firstSector = ((uint32_t)&_FS_end - 0x40200000) / SPI_FLASH_SEC_SIZE - 2;
+  memset(&counters, 0, sizeof(counters));
+  activeSector = 0;
+  bool inFlash = loadFlash();
+
+  // La RTC gana si es válida y no es más vieja que flash: trae los
+  // incrementos que no llegaron a escribirse antes del reset.
+  RtcCounters rtc;
+  ESP.rtcUserMemoryRead(COUNTERS_RTC_BLOCK, (uint32_t*)&rtc, sizeof(rtc));
+  bool fromRtc = rtc.magic == RTC_MAGIC && rtc.crc == checksum(&rtc, offsetof(RtcCounters, crc)) &&
+                 rtc.c.seq >= counters.seq;
+  if (fromRtc) {
+    counters = rtc.c;
+    dirty = rtc.dirty;
+  }
+  saveRtc();
+
+  Serial.println("Contadores: " + String(counters.tokens) + " tokens, " + String(counters.deposits) +
+                 " depositos (" + String(fromRtc ? "RTC" : inFlash ? "flash" : "nuevos") + ")");
+}
+
+void countersAdd(int32_t tokens, int32_t deposits) {
+  counters.tokens += tokens;
+  counters.deposits += deposits;
+  pendingDeposits += deposits;
+  dirty = true;
+  saveRtc();
+}
+
+void countersLoop(bool lowBattery) {
+  // Cambio de día según la hora sincronizada por NTP
+  time_t now = time(nullptr);
+  if (now > TIME_VALID) {
+    struct tm t;
+    localtime_r(&now, &t);
+    int32_t day = (t.tm_year + 1900) * 1000 + t.tm_yday;
+    if (counters.day == 0) {
+      counters.day = day;
+      dirty = true;
+    } else if (day != counters.day) {
+      counters.day = day;
+      counters.deposits = 0;
+      counters.writesPrevDay = counters.writesToday;
+      counters.writesToday = 0;
+      Serial.println("Nuevo dia: depositos a 0");
+      commit();
+      return;
+    }
+  }
+
+  if (!lowBattery) lowBatteryCommitted = false;
+  if (!dirty) return;
+  if (lowBattery && !lowBatteryCommitted) {
+    lowBatteryCommitted = true;   // Una sola escritura al entrar en batería baja
+    commit();
+  } else if (pendingDeposits >= COUNTER_COMMIT_DEPOSITS || millis() - lastCommit >= COUNTER_COMMIT_INTERVAL) {
+    commit();
+  }
+}
+
+void countersCommit() {
+  if (dirty) commit();
+}
+
+void countersRejectImage(uint32_t hash) {
+  if (hash == rejectedImage) return;
+  rejectedImage = hash;
+  commit();
+}
+
+uint32_t countersRejectedImage() {
+  return rejectedImage;
+}
+
+// Días que quedan antes de agotar los ciclos de borrado al ritmo actual
+uint32_t countersEnduranceDays() {
+  uint32_t perDay = max((uint32_t)counters.writesPrevDay, (uint32_t)counters.writesToday);
+  if (perDay == 0) perDay = 1;
+  uint32_t erases = counters.seq / (2 * COUNTER_SLOTS_PER_SECTOR);
+  if (erases >= FLASH_ENDURANCE_CYCLES) return 0;
+  return (uint64_t)(FLASH_ENDURANCE_CYCLES - erases) * 2 * COUNTER_SLOTS_PER_SECTOR / perDay;
+}
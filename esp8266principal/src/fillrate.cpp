@@ -0,0 +1,57 @@
+#include <math.h>
+#include <fillrate.h>
+
+void fillRateReset(FillRateEstimator& e, unsigned long nowMs, float level) {
+  e.level = level;
+  e.rate = 0;
+  e.p00 = 100.0f;
+  e.p01 = 0;
+  e.p11 = 100.0f;
+  e.lastMs = nowMs;
+  e.initialized = true;
+}
+
+void fillRateUpdate(FillRateEstimator& e, unsigned long nowMs, float level) {
+  if (!e.initialized || level < e.level - FILL_EMPTY_DROP) {   // Primera muestra o vaciado
+    fillRateReset(e, nowMs, level);
+    return;
+  }
+
+  // Mover el origen a la muestra actual: c += b*dt, P = F P F^T con F = [1 dt; 0 1]
+  float dt = (nowMs - e.lastMs) / 3600000.0f;
+  e.lastMs = nowMs;
+  e.level += e.rate * dt;
+  e.p00 += 2 * dt * e.p01 + dt * dt * e.p11;
+  e.p01 += dt * e.p11;
+
+  // Olvido: P / lambda, lambda = exp(-dt / memoria)
+  float inv = expf(dt / FILL_MEMORY_HOURS);
+  e.p00 *= inv;
+  e.p01 *= inv;
+  e.p11 *= inv;
+  if (e.p11 > 1e4f) {   // Sin excitación mucho tiempo: acotar la covarianza
+    float s = 1e4f / e.p11;
+    e.p00 *= s;
+    e.p01 *= s;
+    e.p11 = 1e4f;
+  }
+
+  // Corrección con regresor h = [1 0]
+  float residual = level - e.level;
+  float denom = FILL_NOISE_VAR + e.p00;
+  float k0 = e.p00 / denom;
+  float k1 = e.p01 / denom;
+  e.level += k0 * residual;
+  e.rate += k1 * residual;
+  e.p11 -= k1 * e.p01;
+  e.p01 -= k0 * e.p01;
+  e.p00 -= k0 * e.p00;
+}
+
+long fillRateTimeToFull(const FillRateEstimator& e) {
+  if (!e.initialized) return -1;
+  if (e.level >= 100.0f) return 0;
+  if (e.rate <= 0.05f) return -1;
+  float seconds = (100.0f - e.level) / e.rate * 3600.0f;
+  return seconds > FILL_MAX_TTF_S ? -1 : (long)seconds;
+}
@@ -0,0 +1,190 @@
+#include <ESP8266WiFi.h>
+#include <httpserver.h>
+#include <metrics.h>
+
+extern const char* deviceId;
+
+#define HTTP_HEADER_SPACE 160
+#define HTTP_LINE_MAX 64
+#define HISTORY_ROW_MAX 32
+#define HISTORY_BODY_MAX (HTTP_HISTORY_LEN * HISTORY_ROW_MAX + 64)
+
+// Respuesta ya serializada. El cuerpo se escribe en buf + HTTP_HEADER_SPACE y
+// la cabecera justo delante, así se envía con un solo write() sin copiar el cuerpo.
+struct CachedResponse {
+  const char* start;
+  size_t len;
+};
+
+struct HistorySample {
+  uint32_t timeSec;
+  int16_t temp10;      // Décimas de grado
+  uint8_t trash;
+  uint8_t hum;
+  uint8_t bat;
+};
+
+static WiFiServer server(HTTP_SERVER_PORT);
+static WiFiClient pending;                  // Conexión con la petición a medio llegar
+static char requestLine[HTTP_LINE_MAX];
+static uint8_t requestLen = 0;
+static unsigned long pendingSince = 0;
+static bool started = false;
+
+static char statusBuf[HTTP_HEADER_SPACE + TELEMETRY_JSON_MAX];
+static CachedResponse statusResponse = {nullptr, 0};
+static SensorData statusSnapshot;
+static unsigned long statusSec = 0;         // Campo "time" de la respuesta guardada
+
+static char historyBuf[HTTP_HEADER_SPACE + HISTORY_BODY_MAX];
+static CachedResponse historyResponse = {nullptr, 0};
+static HistorySample history[HTTP_HISTORY_LEN];
+static uint8_t historyHead = 0;
+static uint8_t historyCount = 0;
+static unsigned long lastHistory = 0;
+
+static char metricsBuf[HTTP_HEADER_SPACE + METRICS_JSON_MAX];
+static CachedResponse metricsResponse = {nullptr, 0};
+static unsigned long metricsBuiltAt = 0;
+
+static const char NOT_FOUND[] =
+  "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+static size_t formatHeader(char* out, size_t size, size_t bodyLen) {
+  return snprintf(out, size,
+    "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %u\r\n"
+    "Access-Control-Allow-Origin: *\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n",
+    (unsigned)bodyLen);
+}
+
+static CachedResponse frame(char* buf, size_t bodyLen) {
+  char header[HTTP_HEADER_SPACE];
+  size_t h = formatHeader(header, sizeof(header), bodyLen);
+  char* start = buf + HTTP_HEADER_SPACE - h;
+  memcpy(start, header, h);
+  return {start, h + bodyLen};
+}
+
+static void buildStatus(const SensorData& data) {
+  char* body = statusBuf + HTTP_HEADER_SPACE;
+  statusSec = millis() / 1000;
+  int len = formatWebTelemetry(body, TELEMETRY_JSON_MAX, deviceId, data, false, statusSec);
+  if (len <= 0 || len >= TELEMETRY_JSON_MAX) return;
+  statusResponse = frame(statusBuf, len);
+}
+
+// Filas [t, trash, temp, hum, bat] de la más antigua a la más nueva
+static void buildHistory() {
+  char* body = historyBuf + HTTP_HEADER_SPACE;
+  size_t len = snprintf(body, HISTORY_BODY_MAX, "{\"id\":\"%s\",\"fields\":[\"t\",\"trash\",\"temp\",\"hum\",\"bat\"],\"rows\":[", deviceId);
+  for (uint8_t i = 0; i < historyCount; i++) {
+    const HistorySample& s = history[(historyHead + HTTP_HISTORY_LEN - historyCount + i) % HTTP_HISTORY_LEN];
+    unsigned temp = abs(s.temp10);
+    len += snprintf(body + len, HISTORY_BODY_MAX - len, "%s[%lu,%u,%s%u.%u,%u,%u]", i ? "," : "",
+                    (unsigned long)s.timeSec, s.trash, s.temp10 < 0 ? "-" : "", temp / 10, temp % 10, s.hum, s.bat);
+  }
+  len += snprintf(body + len, HISTORY_BODY_MAX - len, "]}");
+  historyResponse = frame(historyBuf, len);
+}
+
+static void addHistory(const SensorData& data) {
+  HistorySample& s = history[historyHead];
+  s.timeSec = millis() / 1000;
+  s.temp10 = (int16_t)lroundf(data.temperature * 10);
+  s.trash = (uint8_t)constrain(lroundf(data.trashLevel), 0, 100);
+  s.hum = (uint8_t)constrain(lroundf(data.humidity), 0, 100);
+  s.bat = (uint8_t)constrain(lroundf(data.batteryLevel), 0, 100);
+  historyHead = (historyHead + 1) % HTTP_HISTORY_LEN;
+  if (historyCount < HTTP_HISTORY_LEN) historyCount++;
+  buildHistory();
+}
+
+// Las métricas cambian en cada vuelta: se regeneran sólo si están viejas y alguien las pide
+static bool refreshMetrics() {
+  if (!metricsResponse.len || millis() - metricsBuiltAt >= HTTP_METRICS_MAX_AGE) {
+    metricsBuiltAt = millis();
+    int len = formatMetrics(metricsBuf + HTTP_HEADER_SPACE, METRICS_JSON_MAX);
+    if (len > 0) metricsResponse = frame(metricsBuf, len);   // Si no cabe se queda la anterior
+  }
+  return metricsResponse.len;
+}
+
+void httpServerBegin() {
+  if (HTTP_SERVER_PORT == 0) return;
+  server.begin();
+  server.setNoDelay(true);
+  started = true;
+  Serial.println("Servidor HTTP local en el puerto " + String(HTTP_SERVER_PORT));
+}
+
+// true cuando ya está la primera línea de la petición
+static bool readRequestLine() {
+  while (pending.available()) {
+    char c = pending.read();
+    if (c == '\n') {
+      requestLine[requestLen] = '\0';
+      return true;
+    }
+    if (c != '\r' && requestLen < HTTP_LINE_MAX - 1) requestLine[requestLen++] = c;
+  }
+  return false;
+}
+
+static bool isPath(const char* path) {
+  size_t n = strlen(path);
+  const char* p = requestLine + 4;   // Tras "GET "
+  return strncmp(p, path, n) == 0 && (p[n] == ' ' || p[n] == '?' || p[n] == '\0');
+}
+
+static void respond() {
+  // El resto de cabeceras no interesa, pero hay que leerlas: cerrar con datos
+  // sin leer hace que lwIP mande RST y el cliente pierda la respuesta
+  uint8_t drain[64];
+  while (pending.available()) pending.read(drain, sizeof(drain));
+
+  bool get = strncmp(requestLine, "GET ", 4) == 0;
+  if (get && isPath("/status") && statusResponse.len) {
+    if (millis() / 1000 != statusSec) buildStatus(statusSnapshot);   // "time" al día
+    pending.write((const uint8_t*)statusResponse.start, statusResponse.len);
+  } else if (get && isPath("/history") && historyResponse.len) {
+    pending.write((const uint8_t*)historyResponse.start, historyResponse.len);
+  } else if (get && isPath("/metrics") && refreshMetrics()) {
+    pending.write((const uint8_t*)metricsResponse.start, metricsResponse.len);
+  } else {
+    pending.write((const uint8_t*)NOT_FOUND, sizeof(NOT_FOUND) - 1);
+  }
+  pending.stop(HTTP_STOP_WAIT_MS);
+  metrics.serverRequests++;
+}
+
+void httpServerLoop(const SensorData& data, bool busy) {
+  if (!started) return;
+
+  if (!statusResponse.len || memcmp(&data, &statusSnapshot, sizeof(SensorData)) != 0) {
+    memcpy(&statusSnapshot, &data, sizeof(SensorData));
+    buildStatus(data);
+  }
+  if (!historyCount || millis() - lastHistory >= HTTP_HISTORY_INTERVAL) {
+    lastHistory = millis();
+    addHistory(data);
+  }
+
+  for (uint8_t served = 0; served < (busy ? 1 : HTTP_MAX_PER_LOOP); served++) {
+    if (!pending) {
+      pending = server.accept();
+      if (!pending) return;
+      requestLen = 0;
+      pendingSince = millis();
+    }
+    if (!readRequestLine()) {
+      if (millis() - pendingSince > HTTP_REQUEST_TIMEOUT) {
+        pending.stop(HTTP_STOP_WAIT_MS);
+        metrics.serverDropped++;
+      }
+      return;   // Llega en otra vuelta
+    }
+    uint32_t t0 = metricsStart();
+    respond();
+    metricsRecord(METRIC_SERVER, t0);
+  }
+}
@@ -1,42 +1,28 @@
 #include <ESP8266WiFi.h>
 #include <ESP8266HTTPClient.h>
 #include <ArduinoJson.h>
-#include <DHT.h>
 #include <dec.h>
+#include <board.h>
+#include <metrics.h>
+#include <telemetry.h>
+#include <fillrate.h>
+#include <counters.h>
+#include <ota.h>
+#include <serialstatus.h>
+#include <stepper.h>
+#include <httpserver.h>
 
 const char* ssid = "Pruebaint1";        // Cambiar según necesite
 const char* password = "holaprueba";    // Cambiar según necesite
 const char* serverURL = "http://192.168.43.42:3000/data";   // Cambiar según necesite
-
-#define TRIG_PIN 5        // D1 - Trigger HC-SR04
-#define ECHO_PIN 4        // D2 - Echo HC-SR04
-#define DHT_PIN 12        // D6 - DHT11
-#define FLAME_PIN 13      // D7 - Sensor de llama
-#define IR_PIN 14         // D5 - Sensor infrarrojo
-#define BUTTON_PIN 0      // D3 - Botón
-#define BATTERY_PIN A0    // ADC - Nivel de batería
-
-#define MOTOR_PIN1 16     // D0
-#define MOTOR_PIN2 2      // D4
-#define MOTOR_PIN3 15     // D8
-#define MOTOR_PIN4 3      // RX   - No tenía otro pin, tenía errores 
-
-#define DHT_TYPE DHT11
-DHT dht(DHT_PIN, DHT_TYPE);
+const char* metricsURL = "http://192.168.43.42:3000/metrics";
+const char* otaURL = "http://192.168.43.42:3000/ota";
+const char* deviceId = "ESP8266_BASURA_01";   // Único por contenedor
+const char* timeZone = "UTC0";                 // Cambiar según necesite (formato POSIX TZ)
 
 // Variables globales
-struct SensorData {
-  float trashLevel;
-  float temperature;
-  float humidity;
-  bool flameDetected;
-  float batteryLevel;
-  int userTokens;
-  int dailyDeposits;
-  bool windowOpen;
-};
-
 SensorData currentData;
+FillRateEstimator fillRate;
 WiFiClient client;
 HTTPClient http;
 
@@ -46,7 +32,14 @@ bool windowIsOpen = false;
 unsigned long lastSensorRead = 0;
 unsigned long lastWebSend = 0;
 unsigned long lastSerialSend = 0;
+unsigned long lastMetricsSerial = 0;
+unsigned long lastMetricsWeb = 0;
 unsigned long windowOpenTime = 0;
+unsigned long lastActivity = 0;
+unsigned long sensorInterval = 3000;
+unsigned long webInterval = 10000;
+bool urgentReport = false;
+bool lastFlameState = false;
 bool lastIRState = HIGH;
 bool wifiConnected = false;
 
@@ -59,18 +52,20 @@ unsigned long lastStepTime = 0;
 const long stepInterval = 3; 
 bool clockwise = true;
 
-// Secuencia de pasos 
-int stepSequence[4][4] = {
-  {HIGH, LOW, LOW, LOW},   
-  {LOW, HIGH, LOW, LOW},   
-  {LOW, LOW, HIGH, LOW},   
-  {LOW, LOW, LOW, HIGH}    
-};
-
 const unsigned long SENSOR_INTERVAL = 3000;     // 3s
 const unsigned long WEB_INTERVAL = 10000;       // 10s
+const unsigned long SENSOR_INTERVAL_FAST = 1000;     // Tapa abierta, casi lleno o fuego
+const unsigned long SENSOR_INTERVAL_IDLE = 15000;    // Sin actividad y lejos de llenarse
+const unsigned long WEB_INTERVAL_FAST = 5000;
+const unsigned long WEB_INTERVAL_IDLE = 60000;
+const unsigned long IDLE_AFTER = 300000;             // 5 min sin abrir la tapa
+const float NEAR_FULL_LEVEL = 75.0;                  // Margen antes de la alerta del 85%
+const long NEAR_FULL_TTF = 3600;                     // Lleno en menos de 1 h
+const long IDLE_TTF = 21600;                         // Lleno en más de 6 h
 const unsigned long SERIAL_INTERVAL = 2000;     // 2s
 const unsigned long WINDOW_TIMEOUT = 10000;       //10s
+const unsigned long METRICS_SERIAL_INTERVAL = 30000;  // 30s
+const unsigned long METRICS_WEB_INTERVAL = 60000;     // 60s
 
 void setup() {
   Serial.begin(115200);
@@ -78,46 +73,48 @@ void setup() {
   
   Serial.println();
   Serial.println("=== INICIANDO SISTEMA ===");
+  otaBegin();
   
   // Pines de sensores y boton
-  pinMode(TRIG_PIN, OUTPUT);
-  pinMode(ECHO_PIN, INPUT);
-  pinMode(FLAME_PIN, INPUT_PULLUP);
-  pinMode(IR_PIN, INPUT_PULLUP);
-  pinMode(BUTTON_PIN, INPUT_PULLUP);
-  digitalWrite(TRIG_PIN, LOW);
+  pinMode(Board::FLAME_PIN, INPUT_PULLUP);
+  pinMode(Board::IR_PIN, INPUT_PULLUP);
+  pinMode(Board::BUTTON_PIN, INPUT_PULLUP);
   yield(); 
 
   // Pines del motor 
-  pinMode(MOTOR_PIN1, OUTPUT);
-  pinMode(MOTOR_PIN2, OUTPUT);
-  pinMode(MOTOR_PIN3, OUTPUT);
-  pinMode(MOTOR_PIN4, OUTPUT);
+  pinMode(Board::MOTOR_PIN1, OUTPUT);
+  pinMode(Board::MOTOR_PIN2, OUTPUT);
+  pinMode(Board::MOTOR_PIN3, OUTPUT);
+  pinMode(Board::MOTOR_PIN4, OUTPUT);
   yield(); 
 
-  digitalWrite(MOTOR_PIN1, LOW);
-  digitalWrite(MOTOR_PIN2, LOW);
-  digitalWrite(MOTOR_PIN3, LOW);
-  digitalWrite(MOTOR_PIN4, LOW);
+  stepperRelease<Board>();
   currentStep = 0;
   yield(); 
 
   //valores por defecto
-  currentData.userTokens = 0;
-  currentData.dailyDeposits = 0;
+  countersBegin();
+  currentData.userTokens = counters.tokens;
+  currentData.dailyDeposits = counters.deposits;
   currentData.windowOpen = false;
   currentData.trashLevel = 50.0;
   currentData.temperature = 25.0;
   currentData.humidity = 60.0;
   currentData.flameDetected = false;
   currentData.batteryLevel = 100.0;
+  currentData.fillRate = 0;
+  currentData.timeToFull = -1;
+  metricsReset();
   
-  Serial.println("Inicializando DHT11...");
-  dht.begin();
+  Serial.println("Inicializando sensores...");
+  Board::Level::begin();
+  Board::Climate::begin();
+  Board::Battery::begin();
   delay(1000);
   yield(); 
 
   setupWiFi();
+  httpServerBegin();
   
   Serial.println("Sistema listo!");
   Serial.println(" Porfa un 20 :) ");  // Era para mi calificación xd 
@@ -132,6 +129,7 @@ void setupWiFi() {
   WiFi.setAutoConnect(true);
   WiFi.setAutoReconnect(true);
   WiFi.begin(ssid, password);
+  configTime(timeZone, "pool.ntp.org");   // Hora para el cambio de día de los contadores
 
   int attempts = 0;
   while (WiFi.status() != WL_CONNECTED && attempts < 15) {
@@ -157,42 +155,62 @@ void setupWiFi() {
 }
 
 void loop() {
+  uint32_t loopStart = metricsStart();
   unsigned long currentTime = millis();
-  if (currentTime - lastSensorRead >= SENSOR_INTERVAL) {    // Leer sensores
+  checkFlame();
+  if (urgentReport || currentTime - lastSensorRead >= sensorInterval) {    // Leer sensores
+    uint32_t t0 = metricsStart();
     readSensors();
+    metricsRecord(METRIC_SENSORS, t0);
     lastSensorRead = currentTime;
+    updateSchedule(currentTime);
   }
   checkButton();     
   checkTrashDeposit();
-  stepMotor();
+  if (motorRunning) {
+    uint32_t t0 = metricsStart();
+    stepMotor();
+    metricsRecord(METRIC_MOTOR, t0);
+  }
  
-  if (wifiConnected && currentTime - lastWebSend >= WEB_INTERVAL) {  // Comunicaciones
+  if (wifiConnected && (urgentReport || currentTime - lastWebSend >= webInterval)) {  // Comunicaciones
+    uint32_t t0 = metricsStart();
     sendDataToWeb();
+    metricsRecord(METRIC_WEB, t0);
     lastWebSend = currentTime;
   }
+  urgentReport = false;
   if (currentTime - lastSerialSend >= SERIAL_INTERVAL) {  //Serial
     sendDataToSerial();
     lastSerialSend = currentTime;
   }
+  if (currentTime - lastMetricsSerial >= METRICS_SERIAL_INTERVAL) {  // Métricas
+    sendMetricsToSerial();
+    lastMetricsSerial = currentTime;
+  }
+  if (wifiConnected && currentTime - lastMetricsWeb >= METRICS_WEB_INTERVAL) {
+    sendMetricsToWeb();
+    lastMetricsWeb = currentTime;
+  }
+
+  httpServerLoop(currentData, motorRunning);   // Consultas locales
 
   checkCriticalAlerts();     // Verificar alertas
   checkWiFiStatus();     
+  countersLoop(currentData.batteryLevel < 20);
+  otaLoop(wifiConnected, motorRunning);
+  currentData.userTokens = counters.tokens;
+  currentData.dailyDeposits = counters.deposits;
   
+  metricsRecord(METRIC_LOOP, loopStart);   // Sin contar el delay() de reposo
   yield();
   delay(50);
 }
 
 void stepMotor() {
   if (!motorRunning) return;
-  if (clockwise) {
-    currentStep = (currentStep + 1) % 4;
-  } else { 
-    currentStep = (currentStep - 1 + 4) % 4;
-  }
-  digitalWrite(MOTOR_PIN1, stepSequence[currentStep][0]);
-  digitalWrite(MOTOR_PIN2, stepSequence[currentStep][1]);
-  digitalWrite(MOTOR_PIN3, stepSequence[currentStep][2]);
-  digitalWrite(MOTOR_PIN4, stepSequence[currentStep][3]);
+  currentStep = stepperNextPhase(currentStep, clockwise);
+  stepperWrite<Board>(currentStep);
   delayMicroseconds(1); 
   stepsTaken++;
   if (stepsTaken >= targetSteps) {
@@ -202,64 +220,65 @@ void stepMotor() {
     if (windowIsOpen) {
       closeWindow();
     }
-  digitalWrite(MOTOR_PIN1, LOW);   // Apagar el motor 
-  digitalWrite(MOTOR_PIN2, LOW);
-  digitalWrite(MOTOR_PIN3, LOW);
-  digitalWrite(MOTOR_PIN4, LOW);
+  stepperRelease<Board>();   // Apagar el motor 
   }
  
 }
 
 void readSensors() {
-  float newTrashLevel = readUltrasonicSensor();
+  float newTrashLevel = Board::Level::read();
   if (newTrashLevel >= 0) {
     currentData.trashLevel = newTrashLevel;
   }
-  float temp = dht.readTemperature();
-  float hum = dht.readHumidity();
+  float temp = Board::Climate::readTemperature();
+  float hum = Board::Climate::readHumidity();
   if (!isnan(temp) && temp > -10 && temp < 60) {
     currentData.temperature = temp;
   }
   if (!isnan(hum) && hum > 0 && hum <= 100) {
     currentData.humidity = hum;
   }
-  currentData.flameDetected = (digitalRead(FLAME_PIN) == LOW);
-  currentData.batteryLevel = readBatteryLevel();
-}
+  currentData.flameDetected = (digitalRead(Board::FLAME_PIN) == LOW);
+  currentData.batteryLevel = Board::Battery::read();
 
-float readUltrasonicSensor() {
-  digitalWrite(TRIG_PIN, LOW);
-  delayMicroseconds(2);
-  digitalWrite(TRIG_PIN, HIGH);
-  delayMicroseconds(10);
-  digitalWrite(TRIG_PIN, LOW);
+  fillRateUpdate(fillRate, millis(), currentData.trashLevel);
+  currentData.fillRate = fillRate.rate;
+  currentData.timeToFull = fillRateTimeToFull(fillRate);
+}
 
-  long duration = pulseIn(ECHO_PIN, HIGH, 30000);
-  if (duration == 0) {
-    return -1; // Timeout
+// Ajusta los intervalos de lectura y envío según el estado del contenedor
+void updateSchedule(unsigned long now) {
+  long ttf = currentData.timeToFull;
+  bool urgent = windowIsOpen || currentData.flameDetected ||
+                currentData.trashLevel >= NEAR_FULL_LEVEL ||
+                (ttf >= 0 && ttf < NEAR_FULL_TTF);
+  bool idle = !urgent && now - lastActivity >= IDLE_AFTER &&
+              currentData.trashLevel < 60 && (ttf < 0 || ttf > IDLE_TTF);
+
+  unsigned long newSensor = urgent ? SENSOR_INTERVAL_FAST : idle ? SENSOR_INTERVAL_IDLE : SENSOR_INTERVAL;
+  unsigned long newWeb = urgent ? WEB_INTERVAL_FAST : idle ? WEB_INTERVAL_IDLE : WEB_INTERVAL;
+  if (newWeb < webInterval) urgentReport = true;   // Al acelerar, avisar ya
+  if (newSensor != sensorInterval) {
+    Serial.println("Intervalos: sensores " + String(newSensor / 1000) + "s, web " + String(newWeb / 1000) + "s");
   }
-  
-  float distance = (duration * 0.034) / 2;
-  if (distance < 2 || distance > 200) {
-    return -1;
-  }
-  float level = map(distance, 5, 33, 100, 0);
-  return constrain(level, 0, 100);
+  sensorInterval = newSensor;
+  webInterval = newWeb;
 }
 
-float readBatteryLevel() {
-  int reading = analogRead(BATTERY_PIN);
-  float voltage = (reading / 1024.0) * 3.3;
-  float batteryVoltage = voltage * 12.1;
-  float percentage = ((batteryVoltage - 10.0) / 2.6) * 100.0;
-  return constrain(percentage, 0, 100);
+// El sensor de llama se revisa en cada vuelta para no esperar al intervalo lento
+void checkFlame() {
+  bool flame = (digitalRead(Board::FLAME_PIN) == LOW);
+  if (flame && !lastFlameState) {
+    urgentReport = true;
+  }
+  lastFlameState = flame;
 }
 
 void checkButton() {
-  bool currentState = digitalRead(BUTTON_PIN);
+  bool currentState = digitalRead(Board::BUTTON_PIN);
   if (lastButtonState == HIGH && currentState == LOW) {
     delay(50);
-    if (digitalRead(BUTTON_PIN) == LOW) {
+    if (digitalRead(Board::BUTTON_PIN) == LOW) {
       if (!windowIsOpen) {
         openWindow();
       }
@@ -276,6 +295,8 @@ void openWindow() {
   motorRunning = true;
   windowIsOpen = true;
   currentData.windowOpen = true;
+  lastActivity = millis();
+  updateSchedule(lastActivity);
   Serial.println("Ventana abierta");
 }
 
@@ -291,12 +312,14 @@ void closeWindow() {
 }
 
 void checkTrashDeposit() {
-  bool currentState = digitalRead(IR_PIN);
+  bool currentState = digitalRead(Board::IR_PIN);
   if (windowIsOpen && lastIRState == HIGH && currentState == LOW) {
     delay(50);
-    if (digitalRead (IR_PIN == LOW)) {
-      currentData.dailyDeposits++;
-      currentData.userTokens += 10;
+    if (digitalRead (Board::IR_PIN == LOW)) {
+      countersAdd(10, 1);
+      currentData.dailyDeposits = counters.deposits;
+      currentData.userTokens = counters.tokens;
+      lastActivity = millis();
       Serial.println("¡Depósito detectado! +5 tokens");
       Serial.println("Total tokens: " + String(currentData.userTokens));
     }
@@ -309,6 +332,7 @@ void checkWiFiStatus() {
     if (!wifiConnected) {
       Serial.println("WiFi reconectado!");
       wifiConnected = true;
+      metricsWiFiReconnect();
     }
   } else {
     if (wifiConnected) {
@@ -324,21 +348,13 @@ void sendDataToWeb() {
   http.begin(client, serverURL);
   http.addHeader("Content-Type", "application/json");
 
-  String json = "{";
-  json += "\"type\":\"data\",";
-  json += "\"trash\":" + String((int)currentData.trashLevel) + ",";
-  json += "\"temp\":" + String((int)currentData.temperature) + ",";
-  json += "\"hum\":" + String((int)currentData.humidity) + ",";
-  json += "\"flame\":" + String(currentData.flameDetected ? "true" : "false") + ",";
-  json += "\"bat\":" + String((int)currentData.batteryLevel) + ",";
-  json += "\"tokens\":" + String(currentData.userTokens) + ",";
-  json += "\"deps\":" + String(currentData.dailyDeposits) + ",";
-  json += "\"win\":" + String(currentData.windowOpen ? "true" : "false") + ",";
-  json += "\"button\":" + String(BUTTON_PIN ? "true" : "false") + ",";  
-  json += "\"time\":" + String(millis() / 1000);
-  json += "}";
+  char json[TELEMETRY_JSON_MAX];
+  int len = formatWebTelemetry(json, sizeof(json), deviceId, currentData,
+                               Board::BUTTON_PIN ? true : false, millis() / 1000);
   
-  int code = http.POST(json);
+  unsigned long postStart = millis();
+  int code = http.POST((uint8_t*)json, len);
+  metricsHttpResult(code, millis() - postStart);
   
   if (code > 0) {
     Serial.println("Web OK: " + String(code));
@@ -350,21 +366,24 @@ void sendDataToWeb() {
 }
 
 void sendDataToSerial() {
-  String json = "{";
-  json += "\"type\":\"status\",";
-  json += "\"trash\":" + String(currentData.trashLevel, 1) + ",";
-  json += "\"temp\":" + String(currentData.temperature, 1) + ",";
-  json += "\"hum\":" + String(currentData.humidity, 1) + ",";
-  json += "\"flame\":" + String(currentData.flameDetected ? "true" : "false") + ",";
-  json += "\"bat\":" + String(currentData.batteryLevel, 1) + ",";
-  json += "\"tokens\":" + String(currentData.userTokens) + ",";
-  json += "\"deps\":" + String(currentData.dailyDeposits) + ",";
-  json += "\"win\":" + String(currentData.windowOpen ? "true" : "false") + ",";
-  json += "\"uptime\":" + String(millis() / 1000) + ",";
-  json += "\"wifi\":" + String(wifiConnected ? "true" : "false");
-  json += "}";
-  
-  Serial.println(json);
+  Serial.print(SERIAL_WAKE_PREAMBLE);
+  Serial.println(serialStatusJson(currentData, wifiConnected, millis() / 1000));
+}
+
+void sendMetricsToSerial() {
+  Serial.println(metricsToJson());
+}
+
+void sendMetricsToWeb() {
+  if (!wifiConnected) return;
+  http.setTimeout(3000);
+  http.begin(client, metricsURL);
+  http.addHeader("Content-Type", "application/json");
+  int code = http.POST(metricsToJson());
+  if (code <= 0) {
+    Serial.println("Metrics Error: " + String(code));
+  }
+  http.end();
 }
 
 void checkCriticalAlerts() {
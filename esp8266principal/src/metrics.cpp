@@ -0,0 +1,104 @@
+#include <ESP8266WiFi.h>
+#include <metrics.h>
+#include <counters.h>
+#include <stdarg.h>
+
+RuntimeMetrics metrics;
+
+static const char* METRIC_NAMES[METRIC_COUNT] = {"loop", "sensors", "web", "motor", "server"};
+
+void metricsReset() {
+  memset(&metrics, 0, sizeof(metrics));
+}
+
+static uint8_t bucketFor(uint32_t us) {
+  // Índice = número de bits significativos, 0us -> cubeta 0
+  uint8_t idx = us ? 32 - __builtin_clz(us) : 0;
+  return idx < METRIC_HIST_BUCKETS ? idx : METRIC_HIST_BUCKETS - 1;
+}
+
+void metricsRecord(MetricId id, uint32_t startCycles) {
+  uint32_t now = ESP.getCycleCount();
+  uint32_t cycles = now - startCycles;   // Resta sin signo: tolera el desborde cada ~53 s
+  uint32_t us = cycles / ESP.getCpuFreqMHz();
+
+  LatencyHistogram &h = metrics.hist[id];
+  h.buckets[bucketFor(us)]++;
+  h.count++;
+  h.sumUs += us;
+  if (us > h.maxUs) h.maxUs = us;
+  if (id == METRIC_LOOP) metrics.loopCycles += cycles;
+
+  metrics.overheadCycles += ESP.getCycleCount() - now;
+}
+
+void metricsHttpResult(int code, uint32_t rttMs) {
+  metrics.httpRttMs = rttMs;
+  if (code <= 0) metrics.httpErrors++;
+}
+
+void metricsWiFiReconnect() {
+  metrics.wifiReconnects++;
+}
+
+// Percentil aproximado: límite superior de la cubeta que lo contiene
+static uint32_t percentileUs(const LatencyHistogram &h, uint8_t pct) {
+  if (h.count == 0) return 0;
+  uint32_t target = ((uint64_t)h.count * pct + 99) / 100;
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < METRIC_HIST_BUCKETS; i++) {
+    seen += h.buckets[i];
+    if (seen >= target) return i == METRIC_HIST_BUCKETS - 1 ? h.maxUs : (1UL << i);
+  }
+  return h.maxUs;
+}
+
+// snprintf encadenado; pos sigue contando aunque no quepa
+static void append(char* buf, size_t len, size_t& pos, const char* fmt, ...) __attribute__((format(printf, 4, 5)));
+static void append(char* buf, size_t len, size_t& pos, const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buf + min(pos, len), pos < len ? len - pos : 0, fmt, args);
+  va_end(args);
+  if (n > 0) pos += n;
+}
+
+int formatMetrics(char* buf, size_t len) {
+  size_t pos = 0;
+  append(buf, len, pos, "{\"type\":\"metrics\",\"uptime\":%lu,\"heap\":%u,\"frag\":%u,\"maxBlock\":%u,",
+         millis() / 1000, (unsigned)ESP.getFreeHeap(), (unsigned)ESP.getHeapFragmentation(),
+         (unsigned)ESP.getMaxFreeBlockSize());
+  append(buf, len, pos, "\"rssi\":%d,\"reconnects\":%u,\"httpRtt\":%u,\"httpErr\":%u,",
+         WiFi.status() == WL_CONNECTED ? (int)WiFi.RSSI() : 0, (unsigned)metrics.wifiReconnects,
+         (unsigned)metrics.httpRttMs, (unsigned)metrics.httpErrors);
+  append(buf, len, pos, "\"serverReq\":%u,\"serverDrop\":%u,", (unsigned)metrics.serverRequests,
+         (unsigned)metrics.serverDropped);
+  append(buf, len, pos, "\"flashWrites\":%u,\"flashWritesPrev\":%u,\"flashSeq\":%u,\"flashDaysLeft\":%u,",
+         (unsigned)counters.writesToday, (unsigned)counters.writesPrevDay, (unsigned)counters.seq,
+         (unsigned)countersEnduranceDays());
+
+  // Overhead de instrumentación en partes por millón del tiempo de loop()
+  uint32_t ppm = metrics.loopCycles ? (uint32_t)(metrics.overheadCycles * 1000000ULL / metrics.loopCycles) : 0;
+  append(buf, len, pos, "\"overheadPpm\":%u", (unsigned)ppm);
+
+  for (uint8_t m = 0; m < METRIC_COUNT; m++) {
+    const LatencyHistogram &h = metrics.hist[m];
+    append(buf, len, pos, ",\"%s\":{\"n\":%u,\"avg\":%u,\"p50\":%u,\"p99\":%u,\"max\":%u,\"hist\":[",
+           METRIC_NAMES[m], (unsigned)h.count, h.count ? (unsigned)(h.sumUs / h.count) : 0u,
+           (unsigned)percentileUs(h, 50), (unsigned)percentileUs(h, 99), (unsigned)h.maxUs);
+    for (uint8_t i = 0; i < METRIC_HIST_BUCKETS; i++) {
+      append(buf, len, pos, i ? ",%u" : "%u", (unsigned)h.buckets[i]);
+    }
+    append(buf, len, pos, "]}");
+  }
+  append(buf, len, pos, "}");
+  return pos < len ? (int)pos : -1;
+}
+
+String metricsToJson() {
+  char* buf = (char*)malloc(METRICS_JSON_MAX);
+  if (!buf) return "{}";
+  String json = formatMetrics(buf, METRICS_JSON_MAX) > 0 ? String(buf) : String("{}");
+  free(buf);
+  return json;
+}
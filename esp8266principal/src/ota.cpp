@@ -0,0 +1,336 @@
+#include <ESP8266WiFi.h>
+#include <ESP8266HTTPClient.h>
+#include <ArduinoJson.h>
+#include <Updater.h>
+#include <user_interface.h>
+#include <ota.h>
+#include <serialstatus.h>
+#include <counters.h>
+
+extern const char* deviceId;
+
+#define OTA_RTC_MAGIC 0x4154534F   // "OSTA"
+// 0-31: comando de copia de eboot (lo escribe Update.end()); luego counters.cpp
+#define OTA_RTC_BLOCK (COUNTERS_RTC_BLOCK + COUNTERS_RTC_BLOCKS)
+
+struct OtaRtcState {
+  uint32_t magic;
+  uint32_t pending;          // Versión nueva sin confirmar
+  uint32_t failedBoots;
+  uint32_t displayHash;      // Hash del MD5 de la última imagen de pantalla reenviada
+  uint32_t imageHash;        // Hash del MD5 de la imagen propia pendiente
+  uint32_t crc;
+};
+
+static_assert(OTA_RTC_BLOCK * 4 + sizeof(OtaRtcState) <= 512, "OtaRtcState no cabe en la memoria RTC de usuario");
+
+struct OtaManifest {
+  String version;
+  String md5;                // De la imagen comprimida
+  String rawMd5;             // De la imagen descomprimida
+  uint32_t size;
+  uint32_t rawSize;
+};
+
+struct OtaStats {
+  uint32_t bytes;            // Incluye lo que se vuelve a pedir al reanudar
+  uint32_t resumes;
+  unsigned long startMs;
+};
+
+static OtaRtcState otaState;
+static bool rollbackNeeded = false;
+static unsigned long lastOtaCheck = 0;
+static bool firstCheckDone = false;
+
+static uint32_t fnv1a(const void* data, size_t len) {
+  const uint8_t* p = (const uint8_t*)data;
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h ^= p[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t len) {
+  crc = ~crc;
+  while (len--) {
+    crc ^= *data++;
+    for (uint8_t k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+  }
+  return ~crc;
+}
+
+static void saveOtaState() {
+  otaState.magic = OTA_RTC_MAGIC;
+  otaState.crc = fnv1a(&otaState, offsetof(OtaRtcState, crc));
+  ESP.rtcUserMemoryWrite(OTA_RTC_BLOCK, (uint32_t*)&otaState, sizeof(otaState));
+}
+
+void otaBegin() {
+  ESP.rtcUserMemoryRead(OTA_RTC_BLOCK, (uint32_t*)&otaState, sizeof(otaState));
+  if (otaState.magic != OTA_RTC_MAGIC || otaState.crc != fnv1a(&otaState, offsetof(OtaRtcState, crc))) {
+    memset(&otaState, 0, sizeof(otaState));
+  }
+
+  if (otaState.pending) {
+    uint32_t reason = ESP.getResetInfoPtr()->reason;
+    if (reason == REASON_EXCEPTION_RST || reason == REASON_SOFT_WDT_RST || reason == REASON_WDT_RST) {
+      otaState.failedBoots++;
+      Serial.println("OTA: arranque fallido " + String(otaState.failedBoots) + "/" + String(OTA_MAX_FAILED_BOOTS));
+    }
+    rollbackNeeded = otaState.failedBoots >= OTA_MAX_FAILED_BOOTS;
+  }
+  saveOtaState();
+  Serial.println("Firmware " + String(FIRMWARE_VERSION));
+}
+
+static bool fetchManifest(const String& base, OtaManifest& m) {
+  WiFiClient client;
+  HTTPClient http;
+  http.setTimeout(3000);
+  http.begin(client, base + "/manifest");
+  int code = http.GET();
+  if (code != 200) {
+    http.end();
+    return false;
+  }
+  JsonDocument doc;
+  DeserializationError error = deserializeJson(doc, http.getStream());
+  http.end();
+  if (error) return false;
+
+  m.version = doc["version"] | "";
+  m.md5 = doc["md5"] | "";
+  m.rawMd5 = doc["rawMd5"] | "";
+  m.size = doc["size"] | 0;
+  m.rawSize = doc["rawSize"] | 0;
+  return m.size > 0 && m.md5.length() == 32;
+}
+
+// Descarga url completa pasando los bytes a sink(). Si se corta, reanuda con
+// Range desde el último byte entregado; si el servidor ignora el Range
+// (responde 200), se descartan los bytes que ya se tenían.
+typedef bool (*OtaSink)(const uint8_t* data, size_t len);
+
+static bool download(const String& url, uint32_t size, OtaSink sink, OtaStats& stats) {
+  uint32_t done = 0;
+  uint8_t buf[512];
+  stats.bytes = 0;
+  stats.resumes = 0;
+  stats.startMs = millis();
+
+  for (uint8_t attempt = 0; done < size && attempt <= OTA_RETRIES; attempt++) {
+    if (attempt) {
+      stats.resumes++;
+      delay(1000);
+    }
+    WiFiClient client;
+    HTTPClient http;
+    http.setTimeout(5000);
+    http.begin(client, url);
+    if (done) http.addHeader("Range", "bytes=" + String(done) + "-");
+    int code = http.GET();
+    if (code != 200 && code != 206) {
+      http.end();
+      continue;
+    }
+
+    uint32_t skip = (code == 200) ? done : 0;
+    WiFiClient* stream = http.getStreamPtr();
+    unsigned long lastData = millis();
+    while (done < size && (http.connected() || stream->available()) && millis() - lastData < 5000) {
+      size_t avail = stream->available();
+      if (!avail) {
+        delay(1);
+        continue;
+      }
+      size_t n = stream->readBytes(buf, min(avail, sizeof(buf)));
+      lastData = millis();
+      stats.bytes += n;
+      size_t start = 0;
+      if (skip) {
+        start = min((size_t)skip, n);
+        skip -= start;
+      }
+      if (n > start) {
+        size_t take = min((size_t)(size - done), n - start);
+        if (!sink(buf + start, take)) {
+          http.end();
+          return false;
+        }
+        done += take;
+      }
+      yield();
+    }
+    http.end();
+  }
+  return done == size;
+}
+
+static void report(const char* target, const OtaManifest& m, const OtaStats& stats, const char* result) {
+  WiFiClient client;
+  HTTPClient http;
+  http.setTimeout(3000);
+  http.begin(client, String(otaURL) + "/report");
+  http.addHeader("Content-Type", "application/json");
+  String json = "{";
+  json += "\"id\":\"" + String(deviceId) + "\",";
+  json += "\"target\":\"" + String(target) + "\",";
+  json += "\"version\":\"" + m.version + "\",";
+  json += "\"bytes\":" + String(stats.bytes) + ",";
+  json += "\"size\":" + String(m.size) + ",";
+  json += "\"rawSize\":" + String(m.rawSize) + ",";
+  json += "\"resumes\":" + String(stats.resumes) + ",";
+  json += "\"ms\":" + String(millis() - stats.startMs) + ",";
+  json += "\"result\":\"" + String(result) + "\"";
+  json += "}";
+  http.POST(json);
+  http.end();
+}
+
+// ---------------------------------------------------------------------------
+// Firmware propio
+
+static bool updaterSink(const uint8_t* data, size_t len) {
+  return Update.write((uint8_t*)data, len) == len;
+}
+
+static void updateSelf(const char* slot) {
+  String base = String(otaURL) + "/esp8266/" + slot;
+  OtaManifest m;
+  if (!fetchManifest(base, m)) return;
+  uint32_t hash = fnv1a(m.md5.c_str(), m.md5.length());
+  bool current = strcmp(slot, "current") == 0;
+  if (current && m.version == FIRMWARE_VERSION) return;
+  if (current && hash == countersRejectedImage()) {
+    Serial.println("OTA: " + m.version + " descartada (rollback)");
+    return;
+  }
+
+  Serial.println("OTA: descargando " + m.version + " (" + String(m.size) + " bytes)");
+  OtaStats stats;
+  if (!Update.begin(m.size)) {
+    Serial.println("OTA: sin espacio");
+    return;
+  }
+  Update.setMD5(m.md5.c_str());
+  bool ok = download(base + "/image", m.size, updaterSink, stats) && Update.end();
+  if (!ok) {
+    Serial.println("OTA: error " + String(Update.getError()));
+    Update.end(true);
+    report("esp8266", m, stats, "error");
+    return;
+  }
+
+  report("esp8266", m, stats, rollbackNeeded ? "rollback" : "ok");
+  otaState.pending = rollbackNeeded ? 0 : 1;   // La anterior ya fue buena
+  otaState.imageHash = hash;
+  otaState.failedBoots = 0;
+  saveOtaState();
+  countersCommit();   // Lo que sólo está en la RTC, a flash antes de reiniciar
+  Serial.println("OTA: listo en " + String(millis() - stats.startMs) + " ms, reiniciando");
+  delay(100);
+  ESP.restart();
+}
+
+// ---------------------------------------------------------------------------
+// Reenvío a la pantalla por UART
+
+static uint8_t frameBuf[OTA_DISPLAY_CHUNK];
+static size_t frameLen = 0;
+static uint32_t frameOffset = 0;
+
+static void sendFrame(uint32_t offset, const uint8_t* data, uint16_t len) {
+  uint8_t header[8] = {OTA_FRAME_SYNC0, OTA_FRAME_SYNC1,
+                       (uint8_t)offset, (uint8_t)(offset >> 8), (uint8_t)(offset >> 16), (uint8_t)(offset >> 24),
+                       (uint8_t)len, (uint8_t)(len >> 8)};
+  uint32_t crc = crc32(0, header + 2, 6);
+  crc = crc32(crc, data, len);
+  Serial.write(header, sizeof(header));
+  Serial.write(data, len);
+  Serial.write((uint8_t*)&crc, 4);
+  yield();
+}
+
+static bool displaySink(const uint8_t* data, size_t len) {
+  while (len) {
+    size_t take = min(len, sizeof(frameBuf) - frameLen);
+    memcpy(frameBuf + frameLen, data, take);
+    frameLen += take;
+    data += take;
+    len -= take;
+    if (frameLen == sizeof(frameBuf)) {
+      sendFrame(frameOffset, frameBuf, frameLen);
+      frameOffset += frameLen;
+      frameLen = 0;
+    }
+  }
+  return true;
+}
+
+static void forwardDisplay() {
+  String base = String(otaURL) + "/display/current";
+  OtaManifest m;
+  if (!fetchManifest(base, m)) return;
+  uint32_t hash = fnv1a(m.md5.c_str(), m.md5.length());
+  if (hash == otaState.displayHash) return;
+
+  // Durante el reenvío no se escribe nada más por Serial: el enlace es binario
+  OtaStats total = {0, 0, millis()};
+  bool ok = true;
+  for (uint8_t pass = 0; pass < OTA_DISPLAY_PASSES && ok; pass++) {
+    Serial.print(SERIAL_WAKE_PREAMBLE);
+    Serial.println("{\"type\":\"ota\",\"version\":\"" + m.version + "\",\"size\":" + String(m.size) +
+                   ",\"md5\":\"" + m.md5 + "\",\"rawSize\":" + String(m.rawSize) +
+                   ",\"rawMd5\":\"" + m.rawMd5 + "\",\"chunk\":" + String(OTA_DISPLAY_CHUNK) +
+                   ",\"pass\":" + String(pass) + "}");
+    Serial.flush();
+    delay(500);   // La pantalla prepara la partición
+
+    frameLen = 0;
+    frameOffset = 0;
+    OtaStats stats;
+    ok = download(base + "/image", m.size, displaySink, stats);
+    if (ok && frameLen) sendFrame(frameOffset, frameBuf, frameLen);
+    if (ok) sendFrame(m.size, frameBuf, 0);
+    Serial.flush();
+    total.bytes += stats.bytes;
+    total.resumes += stats.resumes;
+    delay(2000);   // Tiempo para verificar y reiniciar antes de otra pasada
+  }
+
+  report("display", m, total, ok ? "ok" : "error");
+  if (ok) {
+    otaState.displayHash = hash;
+    saveOtaState();
+  }
+}
+
+void otaLoop(bool wifiConnected, bool motorRunning) {
+  if (!wifiConnected) return;
+  if (motorRunning) return;   // La descarga bloquea: no con la ventana a medio mover
+
+  if (rollbackNeeded) {
+    Serial.println("OTA: volviendo a la version anterior");
+    countersRejectImage(otaState.imageHash);   // No volver a grabarla
+    updateSelf("previous");
+    rollbackNeeded = false;   // Si falla se sigue con esta
+  }
+
+  if (otaState.pending && millis() >= OTA_CONFIRM_MS) {
+    otaState.pending = 0;
+    otaState.failedBoots = 0;
+    saveOtaState();
+    Serial.println("OTA: version " + String(FIRMWARE_VERSION) + " confirmada");
+  }
+
+  unsigned long wait = firstCheckDone ? OTA_CHECK_INTERVAL : OTA_FIRST_CHECK;
+  if (millis() - lastOtaCheck < wait) return;
+  lastOtaCheck = millis();
+  firstCheckDone = true;
+
+  updateSelf("current");
+  forwardDisplay();
+}
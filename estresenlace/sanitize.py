@@ -0,0 +1,3 @@
+# build_flags sólo llega al compilador: los sanitizers también hay que enlazarlos
+Import("env")
+env.Append(LINKFLAGS=["-fsanitize=address,undefined"])
@@ -0,0 +1,846 @@
+// Estrés y fuzzing del enlace UART ESP8266 -> pantalla, en el host.
+//
+// Se usa el mismo código de entrada que la pantalla (LineReader, decodeLine y
+// OtaFrameDecoder de interfazlcdesp/include), no copias, y se simula lo que
+// lo rodea en la placa:
+//   - la UART a 115200 baudios, 8N1 (10 bits por byte)
+//   - el buffer RX de Serial2: si se llena entre dos vueltas, se pierden bytes
+//   - loop(): readSerial() vacía el buffer, repinta si hubo datos (como mucho
+//     cada 100 ms) y espera al siguiente evento de la UART (energia.h)
+// El tiempo de CPU por mensaje se mide de verdad en el host. No hay todavía
+// una medida de decodeLine() en la placa, así que por defecto no se escala y
+// las cifras de CPU son del host. Para estimar el ESP32, --cpu-scale es el
+// cociente entre lo que tarda decodeLine() con una línea de estado en la
+// placa (micros() alrededor de la llamada en parseData) y el cpu_us/msg que
+// da esta rampa sin --cpu-scale. --draw-ms se toma del p99 de "Main" en la
+// pantalla de estadísticas (rendermetrics.h); por defecto es una estimación.
+//
+// Informes:
+//   1. Rampa de msg/s con tráfico grabado (capturas/) y sintético: límite
+//      del enlace sin pérdidas (UART, buffer RX, repintado y CPU escalada),
+//      latencia, CPU por mensaje y memoria del JSON
+//   2. Recuperación de un flujo corrupto: mensajes buenos perdidos y bytes
+//      hasta volver a decodificar
+// Una línea de estado sólo cuenta como recibida si sus campos acaban en
+// SensorData; decodificarla sin que cambie nada es un fallo (p.ej. nombres de
+// campo distintos en el ESP8266 y en la pantalla).
+//   3. --fuzz N: entradas mutadas contra el lector de líneas y el de tramas OTA
+
+#include <ArduinoJson.h>
+#include <estado.h>
+#include <enlace.h>
+#include <otaframe.h>
+
+#include <malloc.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+#define RX_BUFFER_DEFAULT 4096   // OTA_RX_BUFFER (otarx.h necesita Arduino)
+#define DRAW_MS_DEFAULT 40       // ms, sin medir: --draw-ms
+#define FRAME_MIN_INTERVAL 0.1   // s, entre dos updateDisplay()
+#define MAX_WAIT 1.0             // s, POWER_MAX_WAIT_MS
+#define UART_FULL_THRESHOLD 120  // onReceive() salta con 120 bytes en la FIFO...
+#define UART_RX_TIMEOUT 2        // ...o tras 2 bytes de silencio
+#define RESYNC_ZEROS (6 + OTA_RX_MAX_CHUNK + 4)
+#define MAX_LOST_ON_CORRUPTION 2
+
+// ---------------------------------------------------------------------------
+// Memoria de ArduinoJson: la única asignación dinámica de la ruta de entrada
+
+class TrackingAllocator : public ArduinoJson::Allocator {
+public:
+  size_t live = 0;
+  size_t peak = 0;
+  uint64_t allocs = 0;
+
+  void* allocate(size_t n) override {
+    void* p = malloc(n);
+    if (p) track(p);
+    return p;
+  }
+
+  void deallocate(void* p) override {
+    if (p) live -= malloc_usable_size(p);
+    free(p);
+  }
+
+  void* reallocate(void* p, size_t n) override {
+    size_t before = p ? malloc_usable_size(p) : 0;
+    void* q = realloc(p, n);
+    if (!q) return nullptr;
+    live -= before;
+    track(q);
+    return q;
+  }
+
+private:
+  void track(void* p) {
+    live += malloc_usable_size(p);
+    allocs++;
+    if (live > peak) peak = live;
+  }
+};
+
+static TrackingAllocator jsonMemory;
+
+// Campos que manda serialStatusJson() del ESP8266: los que vienen en la línea
+// tienen que estar en SensorData después de aplicarla
+static bool statusApplied(const JsonDocument& doc, const SensorData& d) {
+  const struct {
+    const char* key;
+    float value;
+  } numbers[] = {{"trash", d.trashLevel}, {"temp", d.temperature}, {"hum", d.humidity},
+                 {"bat", d.batteryLevel}, {"tokens", (float)d.userTokens}, {"deps", (float)d.dailyDeposits}};
+  for (const auto& n : numbers) {
+    JsonVariantConst v = doc[n.key];
+    if (!v.isNull() && (v | NAN) != n.value) return false;
+  }
+  JsonVariantConst flame = doc["flame"];
+  return flame.isNull() || (flame | false) == d.flameDetected;
+}
+
+struct Decoded {
+  LineKind kind;
+  long uptime;         // -1 si no es una línea de estado
+  bool applied;        // statusApplied()
+};
+
+// parseData() de la pantalla: documento local por línea
+static Decoded decode(LineReader& reader, SensorData& data) {
+  JsonDocument doc(&jsonMemory);
+  Decoded d;
+  d.kind = decodeLine(doc, reader.buf, reader.len, data);
+  d.uptime = d.kind == LINE_STATUS ? (long)(doc["uptime"] | -1) : -1;
+  d.applied = d.kind == LINE_STATUS && statusApplied(doc, data);
+  reader.consumed();
+  return d;
+}
+
+// Nombres de los campos de a y b que no coinciden
+static std::string differentFields(const SensorData& a, const SensorData& b) {
+  std::string out;
+  if (a.trashLevel != b.trashLevel) out += " trashLevel";
+  if (a.temperature != b.temperature) out += " temperature";
+  if (a.humidity != b.humidity) out += " humidity";
+  if (a.flameDetected != b.flameDetected) out += " flameDetected";
+  if (a.batteryLevel != b.batteryLevel) out += " batteryLevel";
+  if (a.userTokens != b.userTokens) out += " userTokens";
+  if (a.dailyDeposits != b.dailyDeposits) out += " dailyDeposits";
+  return out;
+}
+
+// ---------------------------------------------------------------------------
+// Tráfico
+
+struct Message {
+  std::string bytes;   // Con "\r\n", como Serial.println()
+  bool json;           // La pantalla debería decodificarla
+  bool status;         // ...y aplicarla a SensorData ("type":"status")
+};
+
+// Mismo formato que serialStatusJson() del ESP8266
+static std::string statusLine(std::mt19937& rng, unsigned long uptime) {
+  std::uniform_real_distribution<float> pct(0, 100);
+  char line[320];
+  snprintf(line, sizeof(line),
+    "{\"type\":\"status\",\"trash\":%.1f,\"temp\":%.1f,\"hum\":%.1f,\"flame\":%s,\"bat\":%.1f,"
+    "\"tokens\":%u,\"deps\":%u,\"win\":%s,\"rate\":%.1f,\"ttf\":%u,\"uptime\":%lu,\"wifi\":%s}",
+    pct(rng), pct(rng) * 0.5f, pct(rng), rng() % 50 ? "false" : "true", pct(rng),
+    (unsigned)(rng() % 5000), (unsigned)(rng() % 40), rng() % 4 ? "false" : "true",
+    pct(rng) / 10, (unsigned)(rng() % 360000), uptime, rng() % 10 ? "true" : "false");
+  return line;
+}
+
+static Message toMessage(const std::string& line) {
+  size_t start = line.find_first_not_of(' ');
+  bool json = start != std::string::npos && line[start] == '{';
+  return {line + "\r\n", json, json && line.find("\"type\":\"status\"") != std::string::npos};
+}
+
+static std::vector<Message> syntheticTraffic(uint32_t seed, size_t count) {
+  std::mt19937 rng(seed);
+  std::vector<Message> out;
+  for (size_t i = 0; i < count; i++) out.push_back(toMessage(statusLine(rng, i)));
+  return out;
+}
+
+static std::vector<Message> loadCapture(const char* path) {
+  std::vector<Message> out;
+  FILE* f = fopen(path, "rb");
+  if (!f) return out;
+  std::string line;
+  int c;
+  while ((c = fgetc(f)) != EOF) {
+    if (c == '\n') {
+      if (!line.empty() && line.back() == '\r') line.pop_back();
+      out.push_back(toMessage(line));
+      line.clear();
+    } else {
+      line += (char)c;
+    }
+  }
+  fclose(f);
+  return out;
+}
+
+static double averageLength(const std::vector<Message>& msgs) {
+  double total = 0;
+  for (const Message& m : msgs) total += m.bytes.size();
+  return msgs.empty() ? 0 : total / msgs.size();
+}
+
+// ---------------------------------------------------------------------------
+// Simulación UART + loop()
+
+struct Config {
+  std::string capture = "capturas/esp8266.log";
+  std::vector<double> rates = {0.5, 1, 2, 5, 10, 20, 50, 100, 200};
+  double seconds = 30;            // Simulados por escalón
+  uint32_t baud = 115200;
+  size_t rxBuffer = RX_BUFFER_DEFAULT;
+  double drawMs = DRAW_MS_DEFAULT; // Repintado completo (ver rendermetrics en la placa)
+  double cpuScale = 1;            // Tiempo ESP32 / tiempo host; 1 = sin calibrar
+  uint32_t seed = 1;
+  uint64_t fuzz = 0;
+  size_t maxHeap = 32768;         // Memoria JSON por línea tolerada en el fuzzing
+  std::string replay;
+};
+
+struct StepResult {
+  double rate = 0;
+  double linkLoad = 0;            // Fracción de la UART ocupada
+  uint64_t sent = 0;              // Mensajes JSON que llegaron enteros
+  uint64_t decoded = 0;
+  uint64_t unapplied = 0;         // Estado decodificado que no cambió SensorData
+  uint64_t droppedBytes = 0;
+  double cpuUsPerMsg = 0;         // Host x cpuScale
+  double p99Ms = 0;               // Llegada del '\n' -> decodificada
+  double maxMs = 0;
+  size_t heapPeak = 0;
+  bool sustained = false;
+};
+
+// powerWait(): vuelve con la notificación de onReceive() o en el plazo dado
+static double nextWake(const std::vector<double>& arrival, size_t next, double t, double byteTime, double deadline) {
+  deadline = std::min(deadline, t + MAX_WAIT);
+  size_t j = std::upper_bound(arrival.begin(), arrival.end(), t) - arrival.begin();
+  if (j > next) return t;   // Llegó algo mientras se procesaba: notificación pendiente
+  for (size_t n = 1; j < arrival.size() && arrival[j] < deadline; j++, n++) {
+    bool gap = j + 1 == arrival.size() || arrival[j + 1] - arrival[j] > 1.5 * byteTime;
+    if (n == UART_FULL_THRESHOLD) return arrival[j];
+    if (gap) return std::min(arrival[j] + UART_RX_TIMEOUT * byteTime, deadline);
+  }
+  return std::max(t, deadline);
+}
+
+static StepResult runStep(const std::vector<Message>& source, double rate, const Config& cfg) {
+  StepResult r;
+  r.rate = rate;
+  double byteTime = 10.0 / cfg.baud;
+  r.linkLoad = rate * averageLength(source) * byteTime;
+
+  // Emisor: el mensaje k se imprime en k/rate y sale byte a byte
+  std::vector<char> wire;
+  std::vector<double> arrival;
+  std::vector<bool> jsonEnd;     // Último byte de un mensaje JSON
+  std::vector<bool> statusEnd;   // ...de una línea de estado
+  double lineFree = 0;
+  for (size_t k = 0;; k++) {
+    double due = k / rate;
+    double start = std::max(due, lineFree);
+    if (start >= cfg.seconds) break;
+    const Message& m = source[k % source.size()];
+    for (size_t i = 0; i < m.bytes.size(); i++) {
+      wire.push_back(m.bytes[i]);
+      arrival.push_back(start + (i + 1) * byteTime);
+      jsonEnd.push_back(m.json && i + 1 == m.bytes.size());
+      statusEnd.push_back(m.status && i + 1 == m.bytes.size());
+    }
+    lineFree = start + m.bytes.size() * byteTime;
+  }
+
+  // Receptor: cada vuelta de loop() lee lo que hay en el buffer RX
+  LineReader reader;
+  SensorData data;
+  jsonMemory.peak = jsonMemory.live;
+  std::vector<double> latencies;
+  double cpuNs = 0;
+  uint64_t lines = 0;
+  double t = 0;
+  double lastUpdate = 0;
+  bool needsRedraw = false;
+  size_t next = 0;
+  double lastDrain = 0;
+  while (t < cfg.seconds) {
+    size_t end = std::upper_bound(arrival.begin(), arrival.end(), t) - arrival.begin();
+    size_t keep = std::min(end - next, cfg.rxBuffer);
+    r.droppedBytes += end - next - keep;
+
+    Clock::time_point start = Clock::now();
+    for (size_t i = next; i < next + keep; i++) {
+      if (!reader.push(wire[i])) continue;
+      lines++;
+      Decoded d = decode(reader, data);
+      if (d.kind == LINE_ERROR || !jsonEnd[i]) continue;
+      if (statusEnd[i] && !d.applied) {
+        r.unapplied++;
+      } else {
+        r.decoded++;
+        needsRedraw = true;
+        double busy = std::chrono::duration<double>(Clock::now() - start).count() * cfg.cpuScale;
+        latencies.push_back((t + busy - arrival[i]) * 1000);
+      }
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    cpuNs += ns;
+    next = end;
+    lastDrain = t;
+    t += ns * 1e-9 * cfg.cpuScale;
+
+    if (needsRedraw && t - lastUpdate >= FRAME_MIN_INTERVAL) {
+      t += cfg.drawMs / 1000;
+      needsRedraw = false;
+      lastUpdate = t;
+    }
+    t = nextWake(arrival, next, t, byteTime, needsRedraw ? lastUpdate + FRAME_MIN_INTERVAL : t + MAX_WAIT);
+  }
+
+  for (size_t i = 0; i < arrival.size() && arrival[i] <= lastDrain; i++) {
+    if (jsonEnd[i]) r.sent++;
+  }
+  r.cpuUsPerMsg = lines ? cpuNs * cfg.cpuScale / lines / 1000 : 0;
+  if (!latencies.empty()) {
+    size_t idx = latencies.size() * 99 / 100;
+    std::nth_element(latencies.begin(), latencies.begin() + idx, latencies.end());
+    r.p99Ms = latencies[idx];
+    r.maxMs = *std::max_element(latencies.begin(), latencies.end());
+  }
+  r.heapPeak = jsonMemory.peak - jsonMemory.live;
+  r.sustained = r.droppedBytes == 0 && r.unapplied == 0 && r.decoded >= r.sent && r.linkLoad <= 1;
+  return r;
+}
+
+static void printStep(const StepResult& r) {
+  printf("%8.1f %7.0f%% %8llu %9llu %10llu %9llu %10llu %9.1f %9.1f %10.1f %9zu  %s\n",
+         r.rate, r.linkLoad * 100, (unsigned long long)r.sent, (unsigned long long)r.decoded,
+         (unsigned long long)r.unapplied,
+         (unsigned long long)(r.sent > r.decoded + r.unapplied ? r.sent - r.decoded - r.unapplied : 0),
+         (unsigned long long)r.droppedBytes, r.p99Ms, r.maxMs, r.cpuUsPerMsg, r.heapPeak,
+         r.sustained ? "ok" : r.unapplied ? "NO APLICA" : r.linkLoad > 1 ? "UART saturada" : "PIERDE");
+}
+
+static bool ramp(const char* name, const std::vector<Message>& source, const Config& cfg) {
+  printf("\n== Tráfico %s: %zu líneas, %.0f B/línea de media ==\n", name, source.size(), averageLength(source));
+  printf("%8s %8s %8s %9s %10s %9s %10s %9s %9s %10s %9s  %s\n", "msg/s", "uart", "enviados", "decodif",
+         "sin_efecto", "perdidos", "bytes_perd", "lat_p99", "lat_max", "cpu_us/msg", "json_max", "estado");
+
+  // Calentamiento: que el primer escalón no pague las cachés frías
+  LineReader reader;
+  SensorData data;
+  for (const Message& m : source) {
+    for (char c : m.bytes) if (reader.push(c)) decode(reader, data);
+  }
+
+  double best = 0;
+  double firstBad = 0;
+  double cpuUs = 0;
+  bool applied = true;
+  for (double rate : cfg.rates) {
+    StepResult r = runStep(source, rate, cfg);
+    printStep(r);
+    if (r.unapplied) applied = false;
+    if (r.cpuUsPerMsg > cpuUs) cpuUs = r.cpuUsPerMsg;
+    if (r.sustained && !firstBad) best = rate;
+    if (!r.sustained && !firstBad) firstBad = rate;
+  }
+
+  // Afinar entre el último escalón bueno y el primero malo
+  if (firstBad && best) {
+    double lo = best, hi = firstBad;
+    for (int i = 0; i < 8; i++) {
+      double mid = (lo + hi) / 2;
+      (runStep(source, mid, cfg).sustained ? lo : hi) = mid;
+    }
+    best = lo;
+  }
+  // Con los valores por defecto manda la UART: no es el máximo de la pantalla
+  printf("Límite del enlace sin pérdidas: %.1f msg/s", best);
+  if (!firstBad) printf(" (o más: no falló ningún escalón)");
+  printf("\nTecho sólo por UART: %.0f msg/s (%u baudios, %.0f B/línea); repintado %.0f ms%s",
+         cfg.baud / 10.0 / averageLength(source), cfg.baud, averageLength(source), cfg.drawMs,
+         cfg.drawMs == DRAW_MS_DEFAULT ? " (estimado, sin medir en la placa)" : "");
+  printf("\nTecho sólo por CPU del parser: %.0f msg/s (%.1f us/msg, %s)\n", cpuUs > 0 ? 1e6 / cpuUs : 0, cpuUs,
+         cfg.cpuScale == 1 ? "en el host, sin escalar" : "host x --cpu-scale");
+  if (!applied) printf("FALLA: líneas de estado decodificadas que no cambian SensorData\n");
+  return applied;
+}
+
+// Una línea de estado grabada tiene que pisar todos los campos: se aplica a
+// dos SensorData distintos en todo y tienen que quedar iguales
+static bool checkStatusFields(const std::vector<Message>& recorded, const Config& cfg) {
+  std::string line;
+  for (const Message& m : recorded) {
+    if (m.status) {
+      line = m.bytes;
+      break;
+    }
+  }
+  const char* origin = "grabada";
+  if (line.empty()) {
+    std::mt19937 rng(cfg.seed);
+    line = statusLine(rng, 0) + "\r\n";
+    origin = "sintética";
+  }
+
+  SensorData a;
+  SensorData b;
+  b.trashLevel = -1;
+  b.temperature = -100;
+  b.humidity = -1;
+  b.flameDetected = !a.flameDetected;
+  b.batteryLevel = -1;
+  b.userTokens = -1;
+  b.dailyDeposits = -1;
+  LineReader reader;
+  for (SensorData* d : {&a, &b}) {
+    for (char c : line) if (reader.push(c)) decode(reader, *d);
+  }
+
+  std::string missing = differentFields(a, b);
+  printf("\nLínea de estado %s -> SensorData: %s\n", origin, missing.empty() ? "todos los campos ok" : "FALLA");
+  if (!missing.empty()) printf("  No los cambia:%s\n  %s", missing.c_str(), line.c_str());
+  return missing.empty();
+}
+
+// ---------------------------------------------------------------------------
+// Recuperación de un flujo corrupto
+
+struct Corruption {
+  const char* name;
+  void (*apply)(std::vector<Message>& msgs, size_t at, std::mt19937& rng);
+};
+
+static void flipBit(std::vector<Message>& msgs, size_t at, std::mt19937& rng) {
+  std::string& b = msgs[at].bytes;
+  b[rng() % (b.size() - 2)] ^= 1 << (rng() % 8);
+}
+
+static void dropByte(std::vector<Message>& msgs, size_t at, std::mt19937& rng) {
+  std::string& b = msgs[at].bytes;
+  b.erase(rng() % (b.size() - 2), 1);
+}
+
+static void loseNewline(std::vector<Message>& msgs, size_t at, std::mt19937&) {
+  std::string& b = msgs[at].bytes;
+  b.resize(b.size() - 2);
+}
+
+// El ESP8266 se reinicia a mitad de línea
+static void truncateReboot(std::vector<Message>& msgs, size_t at, std::mt19937&) {
+  std::string& b = msgs[at].bytes;
+  b = b.substr(0, b.size() / 2) + "\r\n=== INICIANDO SISTEMA ===\r\nInicializando sensores...\r\n";
+}
+
+static void noiseBurst(std::vector<Message>& msgs, size_t at, std::mt19937& rng) {
+  std::string noise;
+  for (int i = 0; i < 300; i++) {
+    char c = (char)(rng() & 0xff);
+    noise += c == '\n' ? ' ' : c;
+  }
+  msgs[at].bytes = noise + msgs[at].bytes;
+}
+
+static void binaryWithNewlines(std::vector<Message>& msgs, size_t at, std::mt19937& rng) {
+  std::string noise;
+  for (int i = 0; i < 300; i++) noise += (char)(rng() & 0xff);
+  msgs[at].bytes = noise + msgs[at].bytes;
+}
+
+static void oversizedLine(std::vector<Message>& msgs, size_t at, std::mt19937&) {
+  msgs[at].bytes = std::string(5000, 'x') + msgs[at].bytes;
+}
+
+// Tramas OTA sueltas en modo líneas (el anuncio se perdió)
+static void strayOtaFrames(std::vector<Message>& msgs, size_t at, std::mt19937& rng) {
+  std::string frames;
+  for (int f = 0; f < 3; f++) {
+    uint8_t frame[6 + 200 + 4];
+    uint32_t offset = f * 200;
+    memcpy(frame, &offset, 4);
+    frame[4] = 200;
+    frame[5] = 0;
+    for (int i = 0; i < 200; i++) frame[6 + i] = rng() & 0xff;
+    uint32_t crc = otaCrc32(0, frame, 206);
+    memcpy(frame + 206, &crc, 4);
+    frames += (char)OTA_FRAME_SYNC0;
+    frames += (char)OTA_FRAME_SYNC1;
+    frames.append((const char*)frame, sizeof(frame));
+  }
+  msgs[at].bytes = frames + msgs[at].bytes;
+}
+
+static const Corruption CORRUPTIONS[] = {
+  {"bit_invertido", flipBit},
+  {"byte_perdido", dropByte},
+  {"sin_salto_linea", loseNewline},
+  {"reinicio_a_medias", truncateReboot},
+  {"ruido_300B", noiseBurst},
+  {"binario_con_saltos", binaryWithNewlines},
+  {"linea_5KB", oversizedLine},
+  {"tramas_ota_sueltas", strayOtaFrames},
+};
+
+#define RECOVERY_MESSAGES 200
+#define RECOVERY_AT 100
+
+// Cada mensaje lleva su índice en "uptime" para saber cuáles llegaron
+static bool recovery(const Config& cfg) {
+  printf("\n== Recuperación: %d mensajes, corrupción en el %d ==\n", RECOVERY_MESSAGES, RECOVERY_AT);
+  printf("%-20s %9s %10s %10s %10s %9s  %s\n", "corrupción", "perdidos", "resync_B", "err_json", "sin_efecto",
+         "largas", "estado");
+  bool allOk = true;
+  for (const Corruption& c : CORRUPTIONS) {
+    std::mt19937 rng(cfg.seed);
+    std::vector<Message> msgs = syntheticTraffic(cfg.seed, RECOVERY_MESSAGES);
+    c.apply(msgs, RECOVERY_AT, rng);
+
+    LineReader reader;
+    SensorData data;
+    std::vector<bool> got(RECOVERY_MESSAGES, false);
+    uint32_t errors = 0;
+    uint32_t unapplied = 0;
+    size_t pos = 0;
+    size_t corruptStart = 0;
+    size_t resync = 0;
+    for (size_t m = 0; m < msgs.size(); m++) {
+      if (m == RECOVERY_AT) corruptStart = pos;
+      for (char ch : msgs[m].bytes) {
+        pos++;
+        if (!reader.push(ch)) continue;
+        Decoded d = decode(reader, data);
+        if (d.kind == LINE_ERROR) {
+          errors++;
+        } else if (!d.applied) {
+          unapplied++;
+        } else if (d.uptime >= 0 && d.uptime < RECOVERY_MESSAGES) {
+          got[d.uptime] = true;
+          if (!resync && d.uptime > RECOVERY_AT) resync = pos - corruptStart;
+        }
+      }
+    }
+
+    size_t lost = std::count(got.begin(), got.end(), false);
+    bool tailOk = std::all_of(got.begin() + RECOVERY_AT + MAX_LOST_ON_CORRUPTION, got.end(), [](bool g) { return g; });
+    bool ok = lost <= MAX_LOST_ON_CORRUPTION && tailOk && !unapplied;
+    if (!ok) allOk = false;
+    printf("%-20s %9zu %10zu %10u %10u %9u  %s\n", c.name, lost, resync, errors, unapplied, reader.tooLong,
+           ok ? "ok" : "FALLA");
+  }
+  return allOk;
+}
+
+// ---------------------------------------------------------------------------
+// Fuzzing
+
+struct FuzzStats {
+  uint64_t lines = 0;
+  uint64_t byKind[3] = {0, 0, 0};
+  uint64_t frames = 0;
+  uint64_t badCrc = 0;
+  size_t heapPeak = 0;
+};
+
+static std::string failure;
+
+// Líneas: invariantes del lector y de lo que llega a SensorData
+static bool fuzzLines(const std::string& input, bool newline, LineReader& reader, SensorData& data,
+                      FuzzStats& st, const Config& cfg) {
+  std::string bytes = newline ? input + "\n" : input;
+  for (char c : bytes) {
+    bool complete = reader.push(c);
+    if (reader.len >= LINK_LINE_MAX) {
+      failure = "LineReader pasa de LINK_LINE_MAX";
+      return false;
+    }
+    if (!complete) continue;
+    size_t before = jsonMemory.live;
+    jsonMemory.peak = before;
+    LineKind kind = decode(reader, data).kind;
+    st.lines++;
+    st.byKind[kind]++;
+    size_t used = jsonMemory.peak - before;
+    st.heapPeak = std::max(st.heapPeak, used);
+    if (used > cfg.maxHeap) {
+      failure = "memoria JSON " + std::to_string(used) + " B por una línea";
+      return false;
+    }
+    if (jsonMemory.live != before) {
+      failure = "el documento JSON no libera su memoria";
+      return false;
+    }
+    if (!std::isfinite(data.trashLevel) || !std::isfinite(data.temperature) ||
+        !std::isfinite(data.humidity) || !std::isfinite(data.batteryLevel)) {
+      failure = "valor no finito en SensorData";
+      return false;
+    }
+  }
+  return true;
+}
+
+static std::string buildFrame(uint32_t offset, const std::string& payload) {
+  std::string f;
+  f += (char)OTA_FRAME_SYNC0;
+  f += (char)OTA_FRAME_SYNC1;
+  uint8_t header[6] = {(uint8_t)offset, (uint8_t)(offset >> 8), (uint8_t)(offset >> 16), (uint8_t)(offset >> 24),
+                       (uint8_t)payload.size(), (uint8_t)(payload.size() >> 8)};
+  std::string body((const char*)header, 6);
+  body += payload;
+  uint32_t crc = otaCrc32(0, (const uint8_t*)body.data(), body.size());
+  f += body;
+  f.append((const char*)&crc, 4);
+  return f;
+}
+
+// Tramas: nunca se sale del buffer y, tras RESYNC_ZEROS ceros, una trama
+// válida siempre se decodifica entera (sea cual sea el estado anterior)
+static bool fuzzFrames(const std::string& input, OtaFrameDecoder& decoder, std::mt19937& rng, FuzzStats& st) {
+  for (char c : input) {
+    OtaFrameResult r = decoder.push((uint8_t)c);
+    bool inFrame = decoder.state == OtaFrameDecoder::DATA || decoder.state == OtaFrameDecoder::CRC;
+    if (decoder.pos > sizeof(decoder.frame) || (inFrame && decoder.len > OTA_RX_MAX_CHUNK)) {
+      failure = "OtaFrameDecoder fuera del buffer";
+      return false;
+    }
+    if (r == OTA_FRAME_OK) st.frames++;
+    if (r == OTA_FRAME_BAD_CRC) st.badCrc++;
+  }
+
+  std::string payload;
+  size_t len = rng() % 4 ? rng() % 64 : rng() % (OTA_RX_MAX_CHUNK + 1);
+  for (size_t i = 0; i < len; i++) payload += (char)(rng() & 0xff);
+  uint32_t offset = rng();
+  std::string probe = std::string(RESYNC_ZEROS, '\0') + buildFrame(offset, payload);
+  OtaFrameResult last = OTA_FRAME_PENDING;
+  for (char c : probe) last = decoder.push((uint8_t)c);
+  if (last != OTA_FRAME_OK || decoder.offset() != offset || decoder.len != payload.size() ||
+      memcmp(decoder.data(), payload.data(), payload.size()) != 0) {
+    failure = "OtaFrameDecoder no se resincroniza";
+    return false;
+  }
+  return true;
+}
+
+static const char* INTERESTING[] = {"0", "-1", "1e39", "-1e39", "1e999", "3.4028236e38", "99999999999999999999",
+                                    "-0", "NaN", "Infinity", "null", "true", "\"\"", "[]", "{}", "\"\\u0000\""};
+
+static std::string mutate(const std::vector<std::string>& corpus, std::mt19937& rng) {
+  std::string s = corpus[rng() % corpus.size()];
+  int rounds = 1 + rng() % 6;
+  for (int r = 0; r < rounds; r++) {
+    size_t pos = s.empty() ? 0 : rng() % (s.size() + 1);
+    switch (rng() % 9) {
+      case 0:
+        if (!s.empty()) s[rng() % s.size()] ^= 1 << (rng() % 8);
+        break;
+      case 1: {
+        static const char STRUCTURE[] = "\n\r\0{}[]\":,\\\xff";
+        if (!s.empty()) s[rng() % s.size()] = STRUCTURE[rng() % (sizeof(STRUCTURE) - 1)];
+        break;
+      }
+      case 2: {
+        std::string noise;
+        for (size_t n = 1 + rng() % 16; n; n--) noise += (char)(rng() & 0xff);
+        s.insert(pos, noise);
+        break;
+      }
+      case 3:
+        if (pos < s.size()) s.erase(pos, 1 + rng() % (s.size() - pos));
+        break;
+      case 4:
+        if (pos < s.size()) s.insert(pos, s.substr(pos, 1 + rng() % (s.size() - pos)));
+        break;
+      case 5: {
+        const std::string& other = corpus[rng() % corpus.size()];
+        s = s.substr(0, pos) + other.substr(rng() % (other.size() + 1));
+        break;
+      }
+      case 6:
+        s.insert(pos, std::string(1 + rng() % 2000, "[{\"x"[rng() % 4]));
+        break;
+      case 7: {
+        size_t colon = s.find(':', pos);
+        if (colon == std::string::npos) break;
+        size_t end = s.find_first_of(",}", colon);
+        s.replace(colon + 1, end == std::string::npos ? std::string::npos : end - colon - 1,
+                  INTERESTING[rng() % (sizeof(INTERESTING) / sizeof(INTERESTING[0]))]);
+        break;
+      }
+      case 8: {
+        uint32_t offset = rng();
+        std::string payload(rng() % 64, (char)(rng() & 0xff));
+        s.insert(pos, buildFrame(offset, payload));
+        break;
+      }
+    }
+  }
+  return s;
+}
+
+static std::vector<std::string> fuzzCorpus(const Config& cfg) {
+  std::vector<std::string> corpus;
+  for (const Message& m : loadCapture(cfg.capture.c_str())) corpus.push_back(m.bytes.substr(0, m.bytes.size() - 2));
+  std::mt19937 rng(cfg.seed);
+  for (int i = 0; i < 8; i++) corpus.push_back(statusLine(rng, i));
+  // Nombres largos de las primeras versiones, que applyStatus() también acepta
+  corpus.push_back("{\"trashLevel\":63.4,\"temperature\":24.7,\"humidity\":58.2,\"flameDetected\":false,"
+                   "\"batteryLevel\":81.5,\"userTokens\":1250,\"dailyDeposits\":17}");
+  corpus.push_back("{\"type\":\"ota\",\"version\":\"1.2.1\",\"size\":301234,\"md5\":\"0123456789abcdef0123456789abcdef\"}");
+  return corpus;
+}
+
+static void saveFailure(const std::string& input, uint64_t iteration) {
+  char path[64];
+  snprintf(path, sizeof(path), "fallo-%llu.bin", (unsigned long long)iteration);
+  FILE* f = fopen(path, "wb");
+  if (f) {
+    fwrite(input.data(), 1, input.size(), f);
+    fclose(f);
+  }
+  printf("FALLO en la entrada %llu: %s (guardada en %s; repetir con --replay %s)\n",
+         (unsigned long long)iteration, failure.c_str(), path, path);
+}
+
+static bool fuzz(const Config& cfg) {
+  std::vector<std::string> corpus = fuzzCorpus(cfg);
+  std::mt19937 rng(cfg.seed);
+  LineReader reader;
+  SensorData data;
+  OtaFrameDecoder decoder;
+  FuzzStats st;
+  printf("\n== Fuzzing: %llu entradas, semilla %u, %zu semillas de corpus ==\n",
+         (unsigned long long)cfg.fuzz, cfg.seed, corpus.size());
+
+  Clock::time_point start = Clock::now();
+  for (uint64_t i = 0; i < cfg.fuzz; i++) {
+    std::string input = mutate(corpus, rng);
+    // El lector se conserva entre entradas; a veces sin '\n' para que se mezclen
+    bool ok = fuzzLines(input, rng() % 8 != 0, reader, data, st, cfg) && fuzzFrames(input, decoder, rng, st);
+    if (!ok) {
+      saveFailure(input, i);
+      return false;
+    }
+  }
+  double secs = std::chrono::duration<double>(Clock::now() - start).count();
+  printf("%.0f entradas/s; líneas %llu (estado %llu, ota %llu, error %llu), descartadas por largas %u\n",
+         cfg.fuzz / secs, (unsigned long long)st.lines, (unsigned long long)st.byKind[LINE_STATUS],
+         (unsigned long long)st.byKind[LINE_OTA], (unsigned long long)st.byKind[LINE_ERROR], reader.tooLong);
+  printf("tramas OTA válidas %llu, CRC incorrecto %llu; memoria JSON máxima por línea %zu B\n",
+         (unsigned long long)st.frames, (unsigned long long)st.badCrc, st.heapPeak);
+  printf("Sin fallos\n");
+  return true;
+}
+
+static bool replay(const Config& cfg) {
+  FILE* f = fopen(cfg.replay.c_str(), "rb");
+  if (!f) {
+    fprintf(stderr, "No se pudo abrir %s\n", cfg.replay.c_str());
+    return false;
+  }
+  std::string input;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) input.append(buf, n);
+  fclose(f);
+
+  std::mt19937 rng(cfg.seed);
+  LineReader reader;
+  SensorData data;
+  OtaFrameDecoder decoder;
+  FuzzStats st;
+  bool ok = fuzzLines(input, true, reader, data, st, cfg) && fuzzFrames(input, decoder, rng, st);
+  printf("%s: %zu bytes, %llu líneas, %llu tramas OTA -> %s\n", cfg.replay.c_str(), input.size(),
+         (unsigned long long)st.lines, (unsigned long long)st.frames, ok ? "ok" : failure.c_str());
+  return ok;
+}
+
+// ---------------------------------------------------------------------------
+
+static std::vector<double> parseRates(const char* s) {
+  std::vector<double> out;
+  for (const char* p = s; *p;) {
+    char* end;
+    double v = strtod(p, &end);
+    if (end == p) break;
+    if (v > 0) out.push_back(v);
+    p = *end == ',' ? end + 1 : end;
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+    "Uso: %s [opciones]\n"
+    "  --capture F       tráfico grabado de la UART (capturas/esp8266.log)\n"
+    "  --rates L         escalones en msg/s, separados por comas (0.5,1,2,5,10,20,50,100,200)\n"
+    "  --seconds S       segundos simulados por escalón (30)\n"
+    "  --baud B          velocidad de la UART (115200)\n"
+    "  --rx-buffer N     buffer RX de Serial2 en bytes (4096)\n"
+    "  --draw-ms X       coste de un repintado completo, p99 de Main en la placa (40)\n"
+    "  --cpu-scale X     decodeLine() en la placa / cpu_us/msg en el host (1: cifras del host)\n"
+    "  --seed N          semilla (1)\n"
+    "  --fuzz N          N entradas mutadas en lugar de la rampa\n"
+    "  --max-heap N      memoria JSON máxima por línea en el fuzzing (32768)\n"
+    "  --replay F        pasar un archivo (p.ej. un fallo guardado) por los dos lectores\n", prog);
+}
+
+int main(int argc, char** argv) {
+  Config cfg;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (i + 1 >= argc) { usage(argv[0]); return 1; }
+    const char* v = argv[++i];
+    if (a == "--capture") cfg.capture = v;
+    else if (a == "--rates") cfg.rates = parseRates(v);
+    else if (a == "--seconds") cfg.seconds = atof(v);
+    else if (a == "--baud") cfg.baud = atoi(v);
+    else if (a == "--rx-buffer") cfg.rxBuffer = atoi(v);
+    else if (a == "--draw-ms") cfg.drawMs = atof(v);
+    else if (a == "--cpu-scale") cfg.cpuScale = atof(v);
+    else if (a == "--seed") cfg.seed = strtoul(v, nullptr, 10);
+    else if (a == "--fuzz") cfg.fuzz = strtoull(v, nullptr, 10);
+    else if (a == "--max-heap") cfg.maxHeap = atoi(v);
+    else if (a == "--replay") cfg.replay = v;
+    else { usage(argv[0]); return 1; }
+  }
+  if (cfg.rates.empty() || cfg.seconds <= 0 || cfg.baud == 0 || cfg.rxBuffer == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (!cfg.replay.empty()) return replay(cfg) ? 0 : 1;
+  if (cfg.fuzz) return fuzz(cfg) ? 0 : 1;
+
+  printf("UART %u baudios, buffer RX %zu B, repintado %.0f ms, CPU x%.1f respecto al host%s\n",
+         cfg.baud, cfg.rxBuffer, cfg.drawMs, cfg.cpuScale, cfg.cpuScale == 1 ? " (sin calibrar)" : "");
+  printf("Memoria estática: LineReader %zu B (x2: USB y UART), OtaFrameDecoder %zu B\n",
+         sizeof(LineReader), sizeof(OtaFrameDecoder));
+
+  std::vector<Message> recorded = loadCapture(cfg.capture.c_str());
+  bool ok = checkStatusFields(recorded, cfg);
+  if (recorded.empty()) printf("\nSin tráfico grabado (%s)\n", cfg.capture.c_str());
+  else ok = ramp("grabado", recorded, cfg) && ok;
+  ok = ramp("sintético", syntheticTraffic(cfg.seed, 1000), cfg) && ok;
+  ok = recovery(cfg) && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,379 @@
+// Generador de carga: simula N contenedores que envían telemetría a /data
+// con el mismo formato que sendDataToWeb() del ESP8266 (telemetry.h).
+//
+// Cada dispositivo tiene su propia dinámica de llenado, depósitos, tapa,
+// batería y alertas. Las peticiones se programan en lazo abierto: la latencia
+// se mide desde el instante programado, así que los retrasos por saturación
+// del servidor cuentan (no se esconde la cola).
+
+#include <telemetry.h>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct Config {
+  std::string host = "127.0.0.1";
+  int port = 3000;
+  std::string path = "/data";
+  std::vector<int> deviceSteps = {100};
+  double intervalSec = 10.0;     // Igual que WEB_INTERVAL del firmware
+  double durationSec = 60.0;     // Por escalón
+  double timeScale = 60.0;       // Segundos simulados por segundo real
+  int threads = 8;
+  int timeoutMs = 3000;          // Igual que http.setTimeout() del firmware
+  unsigned seed = 1;
+  bool get = false;              // GET sin cuerpo (servidor HTTP del ESP8266)
+};
+
+// ---------------------------------------------------------------------------
+// Modelo de un contenedor
+
+struct Device {
+  char id[32];
+  SensorData data;
+  double depositsPerHour;   // Tasa media de depósitos
+  double fillPerDeposit;    // % que sube cada depósito
+  double drainPerHour;      // % de batería por hora
+  double lidCloseAt;        // Tiempo simulado en que se cierra la tapa
+  double flameUntil;
+  double simTime;           // Segundos simulados desde el arranque
+  int day;
+  std::mt19937 rng;
+};
+
+static void initDevice(Device& d, int index, unsigned seed) {
+  snprintf(d.id, sizeof(d.id), "SIM_BASURA_%04d", index);
+  d.rng.seed(seed * 7919u + index);
+  std::uniform_real_distribution<double> u(0.0, 1.0);
+
+  d.data.trashLevel = 100.0 * u(d.rng) * 0.6;
+  d.data.temperature = 20.0 + 8.0 * u(d.rng);
+  d.data.humidity = 45.0 + 30.0 * u(d.rng);
+  d.data.flameDetected = false;
+  d.data.batteryLevel = 60.0 + 40.0 * u(d.rng);
+  d.data.userTokens = 0;
+  d.data.dailyDeposits = 0;
+  d.data.windowOpen = false;
+  d.data.fillRate = 0;
+  d.data.timeToFull = -1;
+
+  d.depositsPerHour = 2.0 + 40.0 * u(d.rng) * u(d.rng);   // Pocos muy concurridos
+  d.fillPerDeposit = 0.5 + 1.5 * u(d.rng);
+  d.drainPerHour = 0.3 + 0.7 * u(d.rng);
+  d.lidCloseAt = 0;
+  d.flameUntil = 0;
+  d.simTime = 0;
+  d.day = 0;
+}
+
+static void advanceDevice(Device& d, double dt) {
+  std::uniform_real_distribution<double> u(0.0, 1.0);
+  std::normal_distribution<double> n(0.0, 1.0);
+  d.simTime += dt;
+
+  int day = (int)(d.simTime / 86400.0);
+  if (day != d.day) {
+    d.day = day;
+    d.data.dailyDeposits = 0;
+  }
+
+  // Actividad según la hora del día: casi nula de noche, pico a media tarde
+  double hour = std::fmod(d.simTime / 3600.0, 24.0);
+  double activity = std::max(0.05, std::sin((hour - 6.0) / 16.0 * M_PI));
+  if (hour < 6.0 || hour > 22.0) activity = 0.05;
+
+  std::poisson_distribution<int> deposits(d.depositsPerHour * activity * dt / 3600.0);
+  int k = deposits(d.rng);
+  for (int i = 0; i < k; i++) {
+    d.data.dailyDeposits++;
+    d.data.userTokens += 10;
+    d.data.trashLevel = std::min(100.0, d.data.trashLevel + d.fillPerDeposit);
+    d.lidCloseAt = d.simTime + 10.0;   // WINDOW_TIMEOUT
+  }
+  d.data.windowOpen = d.simTime < d.lidCloseAt;
+
+  // Recolección: cuanto más lleno, más probable que pase el camión
+  if (d.data.trashLevel > 85.0 && u(d.rng) < 0.02 * dt / 60.0 * (d.data.trashLevel - 80.0)) {
+    d.data.trashLevel = 5.0 * u(d.rng);
+  }
+
+  d.data.temperature = std::clamp(d.data.temperature + 0.05 * n(d.rng) * std::sqrt(dt), -5.0, 55.0);
+  d.data.humidity = std::clamp(d.data.humidity + 0.1 * n(d.rng) * std::sqrt(dt), 5.0, 100.0);
+
+  // Batería: descarga continua, carga solar de día
+  double charge = (hour > 9.0 && hour < 17.0) ? 1.5 : 0.0;
+  d.data.batteryLevel = std::clamp(d.data.batteryLevel + (charge - d.drainPerHour) * dt / 3600.0, 0.0, 100.0);
+
+  // Fuego: evento raro que dura unos minutos
+  if (d.simTime >= d.flameUntil && u(d.rng) < 1e-6 * dt) {
+    d.flameUntil = d.simTime + 120.0 + 300.0 * u(d.rng);
+  }
+  d.data.flameDetected = d.simTime < d.flameUntil;
+
+  // Lo que estimaría fillrate.h en el firmware: tasa esperada a esta hora
+  d.data.fillRate = (float)(d.depositsPerHour * activity * d.fillPerDeposit);
+  d.data.timeToFull = d.data.fillRate > 0.05f
+    ? (long)((100.0 - d.data.trashLevel) / d.data.fillRate * 3600.0) : -1;
+}
+
+// ---------------------------------------------------------------------------
+// Cliente HTTP mínimo: una conexión por petición, como el ESP8266.
+// Con --get se hace GET a la ruta, para medir el servidor local del firmware.
+
+enum PostResult { POST_OK = 0, POST_HTTP_ERROR, POST_CONNECT_ERROR, POST_TIMEOUT, POST_IO_ERROR, POST_RESULT_COUNT };
+
+static const char* RESULT_NAMES[POST_RESULT_COUNT] = {"ok", "http", "connect", "timeout", "io"};
+
+static PostResult httpPost(const sockaddr_in& addr, const Config& cfg, const char* body, int bodyLen) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return POST_IO_ERROR;
+
+  timeval tv;
+  tv.tv_sec = cfg.timeoutMs / 1000;
+  tv.tv_usec = (cfg.timeoutMs % 1000) * 1000;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  if (connect(fd, (const sockaddr*)&addr, sizeof(addr)) < 0) {
+    PostResult r = (errno == EINPROGRESS || errno == ETIMEDOUT) ? POST_TIMEOUT : POST_CONNECT_ERROR;
+    close(fd);
+    return r;
+  }
+
+  char req[512 + TELEMETRY_JSON_MAX];
+  int len = cfg.get
+    ? snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: %s:%d\r\nConnection: close\r\n\r\n",
+               cfg.path.c_str(), cfg.host.c_str(), cfg.port)
+    : snprintf(req, sizeof(req),
+               "POST %s HTTP/1.1\r\nHost: %s:%d\r\nContent-Type: application/json\r\n"
+               "Content-Length: %d\r\nConnection: close\r\n\r\n%.*s",
+               cfg.path.c_str(), cfg.host.c_str(), cfg.port, bodyLen, bodyLen, body);
+
+  for (int sent = 0; sent < len;) {
+    ssize_t w = send(fd, req + sent, len - sent, MSG_NOSIGNAL);
+    if (w <= 0) {
+      PostResult r = (errno == EAGAIN || errno == EWOULDBLOCK) ? POST_TIMEOUT : POST_IO_ERROR;
+      close(fd);
+      return r;
+    }
+    sent += w;
+  }
+
+  // Solo interesa la línea de estado; se drena el resto hasta el cierre
+  char resp[1024];
+  int got = 0;
+  int status = -1;
+  for (;;) {
+    ssize_t r = recv(fd, resp + got, sizeof(resp) - 1 - got, 0);
+    if (r < 0) {
+      PostResult res = (errno == EAGAIN || errno == EWOULDBLOCK) ? POST_TIMEOUT : POST_IO_ERROR;
+      close(fd);
+      return res;
+    }
+    if (r == 0) break;
+    got += r;
+    if (status < 0) {
+      resp[got] = '\0';
+      if (strstr(resp, "\r\n")) sscanf(resp, "HTTP/%*s %d", &status);
+    }
+    if (got > (int)sizeof(resp) / 2) got = 0;
+  }
+  close(fd);
+
+  if (status < 0) return POST_IO_ERROR;
+  return (status >= 200 && status < 300) ? POST_OK : POST_HTTP_ERROR;
+}
+
+// ---------------------------------------------------------------------------
+// Ejecución de un escalón con N dispositivos
+
+struct WorkerStats {
+  std::vector<uint32_t> latencyUs;   // Solo peticiones OK
+  uint64_t results[POST_RESULT_COUNT] = {};
+  uint64_t late = 0;                 // Envíos que salieron > 1 intervalo tarde
+};
+
+static void runWorker(const Config& cfg, const sockaddr_in& addr, std::vector<Device>& devices,
+                      size_t first, size_t last, Clock::time_point start, WorkerStats& stats) {
+  const auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(cfg.intervalSec));
+  const auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(cfg.durationSec));
+  const double simDt = cfg.intervalSec * cfg.timeScale;
+
+  // Cada dispositivo arranca con un desfase aleatorio dentro del intervalo
+  std::vector<Clock::time_point> next(last - first);
+  std::mt19937 rng(cfg.seed + (unsigned)first);
+  std::uniform_real_distribution<double> phase(0.0, 1.0);
+  for (auto& t : next) {
+    t = start + std::chrono::duration_cast<Clock::duration>(interval * phase(rng));
+  }
+
+  char body[TELEMETRY_JSON_MAX];
+  for (;;) {
+    size_t i = std::min_element(next.begin(), next.end()) - next.begin();
+    Clock::time_point scheduled = next[i];
+    if (scheduled >= end) break;
+    std::this_thread::sleep_until(scheduled);
+
+    Device& d = devices[first + i];
+    advanceDevice(d, simDt);
+    unsigned long uptime = (unsigned long)(d.simTime / cfg.timeScale);
+    int len = formatWebTelemetry(body, sizeof(body), d.id, d.data, false, uptime);
+
+    if (Clock::now() - scheduled > interval) stats.late++;
+    PostResult r = httpPost(addr, cfg, body, len);
+    stats.results[r]++;
+    if (r == POST_OK) {
+      auto us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - scheduled).count();
+      stats.latencyUs.push_back((uint32_t)us);
+    }
+    next[i] = scheduled + interval;
+  }
+}
+
+static uint32_t percentile(const std::vector<uint32_t>& sorted, double p) {
+  if (sorted.empty()) return 0;
+  size_t idx = (size_t)std::ceil(p / 100.0 * sorted.size());
+  return sorted[std::min(sorted.size() - 1, idx ? idx - 1 : 0)];
+}
+
+static void runStep(const Config& cfg, const sockaddr_in& addr, int nDevices) {
+  std::vector<Device> devices(nDevices);
+  for (int i = 0; i < nDevices; i++) initDevice(devices[i], i, cfg.seed);
+
+  int nThreads = std::max(1, std::min(cfg.threads, nDevices));
+  std::vector<WorkerStats> stats(nThreads);
+  std::vector<std::thread> workers;
+  Clock::time_point start = Clock::now();
+
+  for (int t = 0; t < nThreads; t++) {
+    size_t first = (size_t)nDevices * t / nThreads;
+    size_t last = (size_t)nDevices * (t + 1) / nThreads;
+    workers.emplace_back(runWorker, std::cref(cfg), std::cref(addr), std::ref(devices),
+                         first, last, start, std::ref(stats[t]));
+  }
+  for (auto& w : workers) w.join();
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  WorkerStats total;
+  for (auto& s : stats) {
+    total.latencyUs.insert(total.latencyUs.end(), s.latencyUs.begin(), s.latencyUs.end());
+    for (int r = 0; r < POST_RESULT_COUNT; r++) total.results[r] += s.results[r];
+    total.late += s.late;
+  }
+  std::sort(total.latencyUs.begin(), total.latencyUs.end());
+
+  uint64_t sent = 0;
+  for (int r = 0; r < POST_RESULT_COUNT; r++) sent += total.results[r];
+  uint64_t errors = sent - total.results[POST_OK];
+  double offered = nDevices / cfg.intervalSec;
+
+  printf("%7d %9.1f %9.1f %8.3f %9.2f %9.2f %9.2f %7llu",
+         nDevices, offered, total.results[POST_OK] / elapsed,
+         sent ? 100.0 * errors / sent : 0.0,
+         percentile(total.latencyUs, 50) / 1000.0,
+         percentile(total.latencyUs, 99) / 1000.0,
+         total.latencyUs.empty() ? 0.0 : total.latencyUs.back() / 1000.0,
+         (unsigned long long)total.late);
+  for (int r = 1; r < POST_RESULT_COUNT; r++) {
+    if (total.results[r]) printf("  %s=%llu", RESULT_NAMES[r], (unsigned long long)total.results[r]);
+  }
+  printf("\n");
+  fflush(stdout);
+}
+
+// ---------------------------------------------------------------------------
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+    "Uso: %s [opciones]\n"
+    "  --host H          servidor (127.0.0.1)\n"
+    "  --port P          puerto (3000)\n"
+    "  --path P          ruta de ingesta (/data)\n"
+    "  --devices N[,M..] dispositivos por escalón (100)\n"
+    "  --interval S      segundos entre envíos por dispositivo (10)\n"
+    "  --duration S      duración de cada escalón en segundos (60)\n"
+    "  --time-scale X    segundos simulados por segundo real (60)\n"
+    "  --threads T       hilos emisores (8)\n"
+    "  --timeout MS      timeout por petición (3000)\n"
+    "  --seed S          semilla (1)\n"
+    "  --get             GET a la ruta en vez de POST de telemetría\n", prog);
+}
+
+static std::vector<int> parseList(const char* s) {
+  std::vector<int> out;
+  for (const char* p = s; *p;) {
+    char* e;
+    long v = strtol(p, &e, 10);
+    if (e == p || v <= 0) return {};
+    out.push_back((int)v);
+    p = (*e == ',') ? e + 1 : e;
+    if (*e && *e != ',') return {};
+  }
+  return out;
+}
+
+int main(int argc, char** argv) {
+  Config cfg;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--get") { cfg.get = true; continue; }
+    if (i + 1 >= argc) { usage(argv[0]); return 1; }
+    const char* v = argv[++i];
+    if (a == "--host") cfg.host = v;
+    else if (a == "--port") cfg.port = atoi(v);
+    else if (a == "--path") cfg.path = v;
+    else if (a == "--devices") cfg.deviceSteps = parseList(v);
+    else if (a == "--interval") cfg.intervalSec = atof(v);
+    else if (a == "--duration") cfg.durationSec = atof(v);
+    else if (a == "--time-scale") cfg.timeScale = atof(v);
+    else if (a == "--threads") cfg.threads = atoi(v);
+    else if (a == "--timeout") cfg.timeoutMs = atoi(v);
+    else if (a == "--seed") cfg.seed = (unsigned)atoi(v);
+    else { usage(argv[0]); return 1; }
+  }
+  if (cfg.deviceSteps.empty() || cfg.intervalSec <= 0 || cfg.durationSec <= 0 || cfg.threads <= 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* res = nullptr;
+  if (getaddrinfo(cfg.host.c_str(), nullptr, &hints, &res) != 0 || !res) {
+    fprintf(stderr, "No se pudo resolver %s\n", cfg.host.c_str());
+    return 1;
+  }
+  sockaddr_in addr = *(sockaddr_in*)res->ai_addr;
+  addr.sin_port = htons(cfg.port);
+  freeaddrinfo(res);
+
+  printf("Objetivo: %s http://%s:%d%s  intervalo=%.1fs  duracion=%.0fs/escalon\n",
+         cfg.get ? "GET" : "POST", cfg.host.c_str(), cfg.port, cfg.path.c_str(), cfg.intervalSec, cfg.durationSec);
+  printf("%7s %9s %9s %8s %9s %9s %9s %7s\n",
+         "devices", "offer/s", "ok/s", "err%", "p50(ms)", "p99(ms)", "max(ms)", "late");
+  for (int n : cfg.deviceSteps) runStep(cfg, addr, n);
+  return 0;
+}
@@ -0,0 +1,69 @@
+#ifndef ENERGIA_H
+#define ENERGIA_H
+
+#include <Arduino.h>
+
+// Ahorro de energía de la pantalla (va con la batería del contenedor).
+//
+// loop() ya no sondea cada 50 ms: se bloquea en una notificación de FreeRTOS
+// que dan la UART (onReceive) y la interrupción PENIRQ del táctil, con un
+// tope de POWER_MAX_WAIT_MS para el parpadeo y las exportaciones.
+//
+// Sin toques la pantalla pasa por tres estados:
+//   ACTIVE  brillo máximo, CPU a 240 MHz
+//   DIM     tras POWER_DIM_MS: brillo POWER_BL_DIM, CPU a 80 MHz (la UART y
+//           el SPI siguen a 80 MHz de APB, no cambian de velocidad)
+//   OFF     tras POWER_OFF_MS: retroiluminación y LED RGB apagados, panel en
+//           SLPIN y light sleep entre eventos. Despiertan el táctil, el flanco de
+//           inicio en el RX de la UART y un temporizador
+// Con la pantalla apagada no se dibuja: los datos se aplican y el frame se
+// hace al encenderla. El primer toque sólo la enciende.
+//
+// La UART2 del ESP32 no puede despertar del light sleep; se usa el pin RX
+// como GPIO y se pierden los bytes de ~1 ms que tarda en despertar. El
+// ESP8266 manda antes de cada línea importante SERIAL_WAKE_PREAMBLE ('\n' de
+// relleno que LineReader ignora).
+//
+// El consumo no se puede medir desde el firmware: se estima con el tiempo en
+// cada estado (CPU ocupada, esperando o dormida) y los consumos típicos de
+// abajo. Están sin calibrar: hay que medirlos una vez con un amperímetro en la
+// entrada de 5 V (idleMa con la pantalla en OFF) y corregirlos aquí.
+// Con -DPOWER_SAVE=0 se mantiene la espera por eventos pero sin atenuar ni dormir.
+
+#ifndef POWER_SAVE
+#define POWER_SAVE 1
+#endif
+
+#define POWER_DIM_MS 30000UL
+#define POWER_OFF_MS 120000UL
+#define POWER_BL_DIM 40                // De 255
+#define POWER_BL_CHANNEL 0             // Canal LEDC de TFT_BL
+#define POWER_RX_AWAKE_MS 100UL        // Tras un byte no se duerme: llega el resto de la línea
+#define POWER_MAX_WAIT_MS 1000UL
+#define POWER_SERIAL_INTERVAL 30000UL
+
+// Consumos típicos (mA a 5 V) para la estimación
+#define POWER_MA_CPU_240 50            // Ejecutando, WiFi apagado
+#define POWER_MA_WAIT_240 30           // Bloqueada en la notificación
+#define POWER_MA_CPU_80 27
+#define POWER_MA_WAIT_80 20
+#define POWER_MA_LIGHT_SLEEP 1
+#define POWER_MA_BACKLIGHT 50          // Retroiluminación al 100 %
+#define POWER_MA_PANEL 5               // Controlador del panel fuera de SLPIN
+#define POWER_MA_LED 5                 // LED RGB, un color encendido (apagado en OFF)
+#define POWER_MA_BOARD 5               // Regulador y resto de la placa
+
+enum PowerState { POWER_ACTIVE, POWER_DIM, POWER_OFF, POWER_STATE_COUNT };
+
+void powerBegin(uint8_t touchIrqPin, uint8_t uartRxPin);   // Tras tft.init() y Serial2.begin()
+void powerActivity();                  // Toque o alerta: brillo máximo y cuenta de inactividad a 0
+bool powerScreenOn();
+PowerState powerState();
+bool powerTouchIrq();                  // PENIRQ desde la última llamada
+void powerIgnoreTouchIrq(bool ignore); // Leer el XPT2046 también baja PENIRQ
+void powerWait(uint32_t maxMs);        // Hasta un evento o maxMs
+uint32_t powerEstimatedMa(PowerState s);
+String powerToJson();
+void powerLoop();                      // Exporta por Serial cada POWER_SERIAL_INTERVAL
+
+#endif
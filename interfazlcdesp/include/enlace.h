@@ -0,0 +1,67 @@
+#ifndef ENLACE_H
+#define ENLACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <ArduinoJson.h>
+#include <estado.h>
+
+// Entrada de la UART que viene del ESP8266: líneas JSON terminadas en '\n'.
+// Sin dependencias de Arduino para poder probarla en el host (estresenlace).
+//
+// LineReader junta bytes en un buffer fijo, sin bloquear ni usar String. Una
+// línea más larga que LINK_LINE_MAX (ruido sin '\n') se descarta entera y se
+// vuelve a sincronizar en el siguiente '\n'.
+
+#define LINK_LINE_MAX 1536   // La línea más larga del ESP8266 es la de métricas (~1.3 KB)
+
+struct LineReader {
+  char buf[LINK_LINE_MAX];
+  size_t len = 0;
+  bool discarding = false;
+  uint32_t lines = 0;
+  uint32_t tooLong = 0;
+
+  // true cuando buf tiene una línea completa (terminada en '\0', sin '\r')
+  bool push(char c) {
+    if (c == '\n') {
+      bool complete = !discarding && len > 0;
+      if (complete) {
+        buf[len] = '\0';
+        lines++;
+      }
+      discarding = false;
+      if (!complete) len = 0;
+      return complete;
+    }
+    if (c == '\r' || discarding) return false;
+    if (len >= LINK_LINE_MAX - 1) {
+      discarding = true;
+      tooLong++;
+      len = 0;
+      return false;
+    }
+    buf[len++] = c;
+    return false;
+  }
+
+  // Llamar después de usar la línea devuelta por push()
+  void consumed() {
+    len = 0;
+  }
+};
+
+enum LineKind { LINE_ERROR, LINE_STATUS, LINE_OTA };
+
+// Decodifica una línea. Con LINE_OTA el anuncio queda en doc (otarx.h).
+inline LineKind decodeLine(JsonDocument& doc, const char* line, size_t len, SensorData& data,
+                           DeserializationError* error = nullptr) {
+  DeserializationError err = deserializeJson(doc, line, len);
+  if (error) *error = err;
+  if (err) return LINE_ERROR;
+  if (doc["type"] == "ota") return LINE_OTA;
+  applyStatus(doc, data);
+  return LINE_STATUS;
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef ESTADO_H
+#define ESTADO_H
+
+#include <ArduinoJson.h>
+#include <math.h>
+
+// Datos que muestra la pantalla y cómo se actualizan con un mensaje del ESP8266.
+// Sin dependencias de Arduino para poder compilarse en el host (bancopruebas).
+
+struct SensorData {
+  float trashLevel = 0;
+  float temperature = 0;
+  float humidity = 0;
+  bool flameDetected = false;
+  float batteryLevel = 100;
+  int userTokens = 0;
+  int dailyDeposits = 0;
+  bool connected = false;
+};
+
+// Un número fuera del rango de float (1e39) llega como inf y la pantalla
+// lo convierte a int al dibujar: se conserva el valor anterior
+inline float finiteOr(JsonVariantConst value, float current) {
+  float f = value | current;
+  return isfinite(f) ? f : current;
+}
+
+// El ESP8266 manda los nombres cortos (serialStatusJson: trash, temp...); se
+// aceptan también los largos de las primeras versiones (trashLevel...)
+inline JsonVariantConst statusField(const JsonDocument& doc, const char* shortKey, const char* longKey) {
+  JsonVariantConst value = doc[shortKey];
+  return value.isNull() ? doc[longKey] : value;
+}
+
+// Los campos que no vienen en el mensaje conservan su valor
+inline void applyStatus(const JsonDocument& doc, SensorData& data) {
+  data.trashLevel = finiteOr(statusField(doc, "trash", "trashLevel"), data.trashLevel);
+  data.temperature = finiteOr(statusField(doc, "temp", "temperature"), data.temperature);
+  data.humidity = finiteOr(statusField(doc, "hum", "humidity"), data.humidity);
+  data.flameDetected = statusField(doc, "flame", "flameDetected") | data.flameDetected;
+  data.batteryLevel = finiteOr(statusField(doc, "bat", "batteryLevel"), data.batteryLevel);
+  data.userTokens = statusField(doc, "tokens", "userTokens") | data.userTokens;
+  data.dailyDeposits = statusField(doc, "deps", "dailyDeposits") | data.dailyDeposits;
+  data.connected = true;
+}
+
+#endif
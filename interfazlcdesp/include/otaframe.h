@@ -0,0 +1,83 @@
+#ifndef OTAFRAME_H
+#define OTAFRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Tramas OTA de la UART: A5 5A | offset u32 | len u16 | datos | crc32
+// (little endian; el CRC cubre offset, len y datos). Una trama con len 0
+// cierra la pasada. Sin dependencias de Arduino para poder probarlo en el
+// host (estresenlace).
+
+#define OTA_FRAME_SYNC0 0xA5
+#define OTA_FRAME_SYNC1 0x5A
+#define OTA_RX_MAX_CHUNK 1024
+
+enum OtaFrameResult { OTA_FRAME_PENDING, OTA_FRAME_OK, OTA_FRAME_BAD_CRC };
+
+inline uint32_t otaCrc32(uint32_t crc, const uint8_t* data, size_t len) {
+  crc = ~crc;
+  while (len--) {
+    crc ^= *data++;
+    for (uint8_t k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+  }
+  return ~crc;
+}
+
+struct OtaFrameDecoder {
+  enum State : uint8_t { SYNC0, SYNC1, HEADER, DATA, CRC };
+
+  uint8_t frame[6 + OTA_RX_MAX_CHUNK + 4];
+  size_t pos = 0;
+  uint16_t len = 0;
+  State state = SYNC0;
+
+  void reset() {
+    state = SYNC0;
+  }
+
+  uint32_t offset() const {
+    return frame[0] | (frame[1] << 8) | (frame[2] << 16) | ((uint32_t)frame[3] << 24);
+  }
+
+  const uint8_t* data() const {
+    return frame + 6;
+  }
+
+  // Byte a byte; con OTA_FRAME_OK la trama está en offset()/data()/len
+  OtaFrameResult push(uint8_t b) {
+    switch (state) {
+      case SYNC0:
+        if (b == OTA_FRAME_SYNC0) state = SYNC1;
+        break;
+      case SYNC1:
+        state = (b == OTA_FRAME_SYNC1) ? HEADER : (b == OTA_FRAME_SYNC0 ? SYNC1 : SYNC0);
+        pos = 0;
+        break;
+      case HEADER:
+        frame[pos++] = b;
+        if (pos == 6) {
+          len = frame[4] | (frame[5] << 8);
+          state = len > OTA_RX_MAX_CHUNK ? SYNC0 : len ? DATA : CRC;
+        }
+        break;
+      case DATA:
+        frame[pos++] = b;
+        if (pos == 6u + len) state = CRC;
+        break;
+      case CRC:
+        frame[pos++] = b;
+        if (pos == 6u + len + 4) {
+          state = SYNC0;
+          uint32_t crc;
+          memcpy(&crc, frame + 6 + len, 4);
+          return crc == otaCrc32(0, frame, 6 + len) ? OTA_FRAME_OK : OTA_FRAME_BAD_CRC;
+        }
+        break;
+    }
+    return OTA_FRAME_PENDING;
+  }
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef OTARX_H
+#define OTARX_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <otaframe.h>
+
+// Recepción de la imagen OTA que reenvía el ESP8266 por la UART
+// (formato de trama en otaframe.h).
+//
+// La imagen llega comprimida con zlib y se descomprime con el inflador de
+// la ROM del ESP32 directamente a la partición OTA libre. Se comprueba el
+// MD5 de lo recibido y el de la imagen final antes de arrancarla.
+//
+// Si una trama llega mal se ignoran las siguientes de esa pasada y se
+// retoma en la próxima desde el mismo offset.
+//
+// Rollback: el bootloader que trae Arduino-ESP32 está compilado sin
+// CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE, así que la imagen nueva nunca queda
+// "pendiente de verificar" y el bootloader no vuelve atrás solo. Lo hace la
+// app: antes de reiniciar con la imagen nueva se apunta en NVS que está
+// pendiente; cada arranque tras un pánico o un watchdog cuenta un fallo y
+// con OTA_RX_MAX_FAILED_BOOTS otaRxBegin() arranca la otra partición OTA y
+// apunta el MD5 rechazado para no volver a instalarlo. Hasta
+// otaRxConfirmBoot() la imagen sigue pendiente.
+// Límite: no se detecta un fallo antes de otaRxBegin() (constructores
+// globales) ni un cuelgue que no dispare ningún watchdog.
+
+#define OTA_RX_IDLE_TIMEOUT 30000UL    // Sin tramas: se abandona la sesión
+#define OTA_RX_BUFFER 4096             // Buffer RX de Serial2 (antes de begin())
+#define OTA_RX_MAX_FAILED_BOOTS 3
+
+void otaRxBegin();                       // Lo primero en setup()
+bool otaRxAnnounce(JsonDocument& doc);   // Línea {"type":"ota",...}
+bool otaRxActive();
+void otaRxPoll(Stream& in);
+void otaRxConfirmBoot();                 // Llamar cuando la pantalla ya funciona
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef RENDERMETRICS_H
+#define RENDERMETRICS_H
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+
+// Instrumentación del dibujado:
+//   - tiempo de dibujo de cada pantalla y bytes enviados por SPI
+//   - dato recibido -> pantalla repintada
+//   - toque -> pantalla repintada
+//   - salida del light sleep -> pantalla repintada (energia.h)
+//
+// Histogramas de cubetas fijas (la cubeta k cuenta duraciones < 2^k us).
+// Son "rodantes": cada RENDER_WINDOW_MS la ventana actual pasa a ser la
+// anterior y se empieza otra; lo que se muestra suma las dos.
+
+#define RENDER_HIST_BUCKETS 21        // 2^20 us ~ 1 s
+#define RENDER_WINDOW_MS 60000UL
+#define RENDER_SERIAL_INTERVAL 30000UL
+
+#if defined(ST7789_DRIVER)
+#define RENDER_PANEL "ST7789"
+#else
+#define RENDER_PANEL "ILI9341"
+#endif
+
+enum RenderMetric {
+  RENDER_MAIN = 0,             // Las tres primeras coinciden con currentScreen
+  RENDER_STATS,
+  RENDER_CONFIG,
+  RENDER_DATA_TO_PIXEL,
+  RENDER_TOUCH_TO_PIXEL,
+  RENDER_WAKE_TO_PIXEL,
+  RENDER_METRIC_COUNT
+};
+
+#define RENDER_SCREENS 3
+
+struct RenderHistogram {
+  uint32_t buckets[RENDER_HIST_BUCKETS];
+  uint32_t count;
+  uint32_t maxUs;
+  uint64_t sumUs;
+};
+
+struct RenderWindow {
+  RenderHistogram hist[RENDER_METRIC_COUNT];
+  uint64_t spiBytes[RENDER_SCREENS];
+};
+
+// TFT_eSPI que cuenta los bytes que manda al panel. La librería escribe
+// directo en los registros SPI, así que se estima desde las primitivas
+// virtuales: 2 bytes por píxel más CASET/PASET/RAMWR por ventana.
+class CountingTFT : public TFT_eSPI {
+public:
+  uint32_t bytesPushed = 0;
+
+  using TFT_eSPI::drawChar;   // Que el override no oculte las otras sobrecargas
+  void drawPixel(int32_t x, int32_t y, uint32_t color) override;
+  void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) override;
+  void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color) override;
+  void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) override;
+  void drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32_t bg, uint8_t size) override;
+};
+
+void renderMarkData();                     // Llegó un dato que hay que mostrar
+void renderMarkTouch();                    // Toque que cambia la pantalla
+void renderMarkWake(uint32_t atUs);        // Se enciende la pantalla; atUs = micros() al despertar
+void renderFrameDone(uint8_t screen, uint32_t drawUs, uint32_t bytes);
+
+uint32_t renderPercentile(RenderMetric m, uint8_t pct);
+uint32_t renderAvgBytes(uint8_t screen);
+String renderToJson();
+void renderLoop();                         // Exporta por Serial cada RENDER_SERIAL_INTERVAL
+
+#endif
@@ -0,0 +1,265 @@
+#include <energia.h>
+#include <rendermetrics.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+
+extern CountingTFT tft;
+void setLED(int r, int g, int b);   // main.cpp
+
+#define PANEL_SLEEP_SETTLE_MS 120   // SLPIN -> SLPOUT (ILI9341 y ST7789)
+#define WAKE_RX_SAMPLE_US 20        // Dos bits a 115200: el relleno '\n' tiene 6 bits bajos de 10
+
+enum WakeCause { WAKE_UART, WAKE_TOUCH, WAKE_TIMER, WAKE_CAUSE_COUNT };
+
+struct PowerStats {
+  uint64_t busyUs[POWER_STATE_COUNT];
+  uint64_t waitUs[POWER_STATE_COUNT];
+  uint64_t sleepUs[POWER_STATE_COUNT];
+  uint32_t wakes[WAKE_CAUSE_COUNT];
+  uint32_t maxExitUs;         // Retraso al salir del light sleep (despertares por temporizador)
+};
+
+static PowerStats stats;
+static PowerState state = POWER_ACTIVE;
+static TaskHandle_t loopTask = nullptr;
+static uint8_t touchPin = 0;
+static uint8_t rxPin = 0;
+static volatile bool touchIrq = false;
+static volatile bool ignoreTouch = false;
+static volatile unsigned long lastRx = 0;
+static unsigned long lastActivity = 0;
+static unsigned long panelOffAt = 0;
+static unsigned long lastExport = 0;
+static uint32_t resumedAt = 0;   // micros() al volver de la última espera
+
+static const char* STATE_NAMES[POWER_STATE_COUNT] = {"active", "dim", "off"};
+static const char* WAKE_NAMES[WAKE_CAUSE_COUNT] = {"uart", "touch", "timer"};
+
+static void IRAM_ATTR onTouchIrq() {
+  if (ignoreTouch) return;
+  touchIrq = true;
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(loopTask, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+// Tarea de eventos de la UART: sólo avisa, los bytes los lee loop()
+static void onUartData() {
+  lastRx = millis();
+  xTaskNotifyGive(loopTask);
+}
+
+static void setBacklight(uint8_t level) {
+#if TFT_BACKLIGHT_ON == LOW
+  level = 255 - level;
+#endif
+  ledcWrite(POWER_BL_CHANNEL, level);
+}
+
+static void enter(PowerState s) {
+  if (s == state) return;
+  if (state == POWER_OFF) {
+    unsigned long off = millis() - panelOffAt;
+    if (off < PANEL_SLEEP_SETTLE_MS) delay(PANEL_SLEEP_SETTLE_MS - off);
+    tft.writecommand(TFT_SLPOUT);
+    delay(5);
+    tft.writecommand(TFT_DISPON);
+  }
+  switch (s) {
+    case POWER_ACTIVE:
+      setCpuFrequencyMhz(240);
+      setBacklight(255);
+      break;
+    case POWER_DIM:
+      setCpuFrequencyMhz(80);
+      setBacklight(POWER_BL_DIM);
+      break;
+    case POWER_OFF:
+      setBacklight(0);
+      setLED(0, 0, 0);   // Antes del primer light sleep; luego los mantiene updateLEDs()
+      tft.writecommand(TFT_DISPOFF);
+      tft.writecommand(TFT_SLPIN);
+      panelOffAt = millis();
+      setCpuFrequencyMhz(80);
+      break;
+    default:
+      break;
+  }
+  state = s;
+  Serial.println("Energia: " + String(STATE_NAMES[s]));
+}
+
+void powerBegin(uint8_t touchIrqPin, uint8_t uartRxPin) {
+  loopTask = xTaskGetCurrentTaskHandle();
+  touchPin = touchIrqPin;
+  rxPin = uartRxPin;
+  lastActivity = millis();
+  resumedAt = micros();
+
+  // tft.init() deja TFT_BL como salida digital: se pasa a PWM
+  ledcSetup(POWER_BL_CHANNEL, 5000, 8);
+  ledcAttachPin(TFT_BL, POWER_BL_CHANNEL);
+  setBacklight(255);
+
+  pinMode(touchPin, INPUT);
+  attachInterrupt(touchPin, onTouchIrq, FALLING);
+  Serial2.onReceive(onUartData);
+  Serial.onReceive(onUartData);
+}
+
+void powerActivity() {
+  lastActivity = millis();
+  if (state == POWER_OFF) renderMarkWake(resumedAt);
+  enter(POWER_ACTIVE);
+}
+
+bool powerScreenOn() {
+  return state != POWER_OFF;
+}
+
+PowerState powerState() {
+  return state;
+}
+
+bool powerTouchIrq() {
+  bool pending = touchIrq;
+  touchIrq = false;
+  return pending;
+}
+
+void powerIgnoreTouchIrq(bool ignore) {
+  ignoreTouch = ignore;
+}
+
+// No dormir con datos a medio llegar o con un evento sin atender
+static bool canSleep() {
+  if (millis() - lastRx < POWER_RX_AWAKE_MS) return false;
+  if (touchIrq || Serial2.available() || Serial.available()) return false;
+  return ulTaskNotifyValueClear(nullptr, 0) == 0;
+}
+
+// Tras despertar por GPIO: si fue la UART, el relleno sigue llegando y el RX
+// baja en unos pocos us. PENIRQ no sirve, un toque rápido ya puede haberlo soltado
+static bool rxActive() {
+  uint32_t start = micros();
+  do {
+    if (digitalRead(rxPin) == LOW) return true;
+  } while (micros() - start < WAKE_RX_SAMPLE_US);
+  return false;
+}
+
+static void lightSleep(uint32_t maxMs) {
+  Serial.flush();
+  gpio_intr_disable((gpio_num_t)touchPin);
+  gpio_wakeup_enable((gpio_num_t)touchPin, GPIO_INTR_LOW_LEVEL);
+  gpio_wakeup_enable((gpio_num_t)rxPin, GPIO_INTR_LOW_LEVEL);   // Bit de inicio
+  esp_sleep_enable_gpio_wakeup();
+  esp_sleep_enable_timer_wakeup((uint64_t)maxMs * 1000);
+
+  uint32_t start = micros();
+  esp_light_sleep_start();
+  uint32_t slept = micros() - start;
+
+  gpio_wakeup_disable((gpio_num_t)rxPin);
+  gpio_wakeup_disable((gpio_num_t)touchPin);
+  gpio_set_intr_type((gpio_num_t)touchPin, GPIO_INTR_NEGEDGE);   // La de attachInterrupt()
+  gpio_intr_enable((gpio_num_t)touchPin);
+
+  if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER) {
+    stats.wakes[WAKE_TIMER]++;
+    uint32_t late = slept > maxMs * 1000 ? slept - maxMs * 1000 : 0;
+    if (late > stats.maxExitUs) stats.maxExitUs = late;
+    return;
+  }
+  // Pueden haber coincidido las dos fuentes: un toque durante la UART no se pierde
+  bool touched = digitalRead(touchPin) == LOW;
+  if (rxActive()) {
+    stats.wakes[WAKE_UART]++;
+    lastRx = millis();    // Quedarse despierto para el resto de la línea
+  } else {
+    stats.wakes[WAKE_TOUCH]++;
+    touched = true;       // Sin RX fue el táctil, aunque PENIRQ ya se haya soltado
+  }
+  if (touched) touchIrq = true;   // El flanco fue dormido: la ISR no lo vio
+}
+
+void powerWait(uint32_t maxMs) {
+  stats.busyUs[state] += micros() - resumedAt;
+
+#if POWER_SAVE
+  unsigned long idle = millis() - lastActivity;
+  if (state == POWER_ACTIVE && idle >= POWER_DIM_MS) enter(POWER_DIM);
+  if (state == POWER_DIM && idle >= POWER_OFF_MS) enter(POWER_OFF);
+#endif
+
+  uint32_t start = micros();
+  if (POWER_SAVE && state == POWER_OFF && maxMs && canSleep()) {
+    lightSleep(maxMs);
+    stats.sleepUs[state] += micros() - start;
+  } else {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(maxMs));
+    stats.waitUs[state] += micros() - start;
+  }
+  resumedAt = micros();
+}
+
+static uint64_t timeIn(PowerState s) {
+  return stats.busyUs[s] + stats.waitUs[s] + stats.sleepUs[s];
+}
+
+uint32_t powerEstimatedMa(PowerState s) {
+  uint64_t total = timeIn(s);
+  bool fast = s == POWER_ACTIVE;
+  uint32_t cpuMa;
+  if (total) {
+    cpuMa = (stats.busyUs[s] * (fast ? POWER_MA_CPU_240 : POWER_MA_CPU_80) +
+             stats.waitUs[s] * (fast ? POWER_MA_WAIT_240 : POWER_MA_WAIT_80) +
+             stats.sleepUs[s] * POWER_MA_LIGHT_SLEEP) / total;
+  } else {
+    // Sin tiempo en el estado todavía: lo típico en reposo (dormida si OFF)
+    cpuMa = s == POWER_OFF && POWER_SAVE ? POWER_MA_LIGHT_SLEEP : fast ? POWER_MA_WAIT_240 : POWER_MA_WAIT_80;
+  }
+  uint8_t backlight = s == POWER_ACTIVE ? 255 : s == POWER_DIM ? POWER_BL_DIM : 0;
+  uint32_t screenMa = s == POWER_OFF ? 0 : POWER_MA_PANEL + POWER_MA_LED;
+  return cpuMa + POWER_MA_BACKLIGHT * backlight / 255 + screenMa + POWER_MA_BOARD;
+}
+
+String powerToJson() {
+  uint64_t total = 0;
+  uint64_t weighted = 0;
+  for (uint8_t s = 0; s < POWER_STATE_COUNT; s++) {
+    total += timeIn((PowerState)s);
+    weighted += timeIn((PowerState)s) * powerEstimatedMa((PowerState)s);
+  }
+
+  String json = "{";
+  json += "\"type\":\"power\",";
+  json += "\"state\":\"" + String(STATE_NAMES[state]) + "\",";
+  json += "\"cpuMhz\":" + String(getCpuFrequencyMhz()) + ",";
+  json += "\"avgMa\":" + String(total ? (uint32_t)(weighted / total) : 0) + ",";
+  json += "\"idleMa\":" + String(powerEstimatedMa(POWER_SAVE ? POWER_OFF : POWER_ACTIVE)) + ",";
+  json += "\"wakeToPixelP50\":" + String(renderPercentile(RENDER_WAKE_TO_PIXEL, 50)) + ",";
+  json += "\"wakeToPixelP99\":" + String(renderPercentile(RENDER_WAKE_TO_PIXEL, 99)) + ",";
+  json += "\"exitUs\":" + String(stats.maxExitUs) + ",";
+  json += "\"wakes\":{";
+  for (uint8_t w = 0; w < WAKE_CAUSE_COUNT; w++) {
+    if (w) json += ",";
+    json += "\"" + String(WAKE_NAMES[w]) + "\":" + String(stats.wakes[w]);
+  }
+  json += "}";
+  for (uint8_t s = 0; s < POWER_STATE_COUNT; s++) {
+    uint64_t t = timeIn((PowerState)s);
+    json += ",\"" + String(STATE_NAMES[s]) + "\":{";
+    json += "\"pct\":" + String(total ? (uint32_t)(t * 100 / total) : 0) + ",";
+    json += "\"sleepPct\":" + String(t ? (uint32_t)(stats.sleepUs[s] * 100 / t) : 0) + ",";
+    json += "\"ma\":" + String(powerEstimatedMa((PowerState)s)) + "}";
+  }
+  json += "}";
+  return json;
+}
+
+void powerLoop() {
+  if (millis() - lastExport < POWER_SERIAL_INTERVAL) return;
+  lastExport = millis();
+  Serial.println(powerToJson());
+}
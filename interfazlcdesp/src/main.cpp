@@ -2,6 +2,11 @@
 #include <ArduinoJson.h>
 #include <TFT_eSPI.h>
 #include <XPT2046_Bitbang.h>  
+#include <otarx.h>
+#include <estado.h>
+#include <enlace.h>
+#include <rendermetrics.h>
+#include <energia.h>
 
 #define XPT2046_IRQ 36
 #define XPT2046_MOSI 32
@@ -9,7 +14,7 @@
 #define XPT2046_CLK 25
 #define XPT2046_CS 33
 
-TFT_eSPI tft = TFT_eSPI();
+CountingTFT tft;   // TFT_eSPI que cuenta los bytes SPI (rendermetrics.h)
 XPT2046_Bitbang ts(XPT2046_MOSI, XPT2046_MISO, XPT2046_CLK, XPT2046_CS);
 
 #define PIN_TX 1
@@ -27,17 +32,6 @@ XPT2046_Bitbang ts(XPT2046_MOSI, XPT2046_MISO, XPT2046_CLK, XPT2046_CS);
 #define BLUE    0x001F
 #define CYAN    0x07FF
 
-struct SensorData {
-  float trashLevel = 0;
-  float temperature = 0;
-  float humidity = 0;
-  bool flameDetected = false;
-  float batteryLevel = 100;
-  int userTokens = 0;
-  int dailyDeposits = 0;
-  bool connected = false;
-};
-
 struct Button {
   int x, y, w, h;
   String label;
@@ -48,7 +42,8 @@ struct Button {
 };
 
 SensorData data;
-String inputBuffer = "";
+LineReader usbLine;
+LineReader uartLine;
 unsigned long lastUpdate = 0;
 unsigned long lastBlink = 0;
 unsigned long lastTouch = 0;
@@ -70,7 +65,7 @@ int currentScreen = 0; // 0=Main, 1=Stats, 2=Config
 
 // Funciones 
 void readSerial();
-void parseData(String jsonData);
+void parseData(LineReader& line);
 void sendCommand(String command);
 void handleTouch();
 void updateDisplay();
@@ -82,6 +77,7 @@ void showStartup();
 void showMainScreen();
 void showStatsScreen();
 void showConfigScreen();
+void drawRenderStats(int y);
 
 void drawBattery();
 void drawTrashLevel();
@@ -91,6 +87,8 @@ void drawButton(Button &btn);
 
 void setup() {
   Serial.begin(115200);
+  otaRxBegin();
+  Serial2.setRxBufferSize(OTA_RX_BUFFER);
   Serial2.begin(115200, SERIAL_8N1, PIN_RX, PIN_TX); 
 
   pinMode(LED_RED, OUTPUT);
@@ -123,16 +121,36 @@ void setup() {
   data.userTokens = 150;
   data.dailyDeposits = 5;
   data.connected = true;
+
+  powerBegin(XPT2046_IRQ, PIN_RX);
   
   Serial.println("Sistema iniciado");
 }
 
 void loop() {
   readSerial();
-  handleTouch();
+
+  // Recibiendo OTA: vaciar la UART sin pausas para no perder tramas
+  if (otaRxActive()) {
+    otaRxPoll(Serial2);
+    return;
+  }
+
+  // El táctil se lee con PENIRQ o mientras sigue pulsado (para ver la liberación)
+  if (powerTouchIrq() || touchPressed) {
+    if (powerScreenOn()) {
+      handleTouch();
+    } else {
+      powerActivity();   // El primer toque sólo enciende la pantalla
+      needsRedraw = true;
+    }
+  }
   updateLEDs();
+  renderLoop();
+  powerLoop();
 
-  if (millis() - lastUpdate > 500) {
+  // Sólo se dibuja si cambió algo (datos, toque, parpadeo) y con la pantalla encendida
+  if (needsRedraw && powerScreenOn() && millis() - lastUpdate >= 100) {
     updateDisplay();
     lastUpdate = millis();
   }
@@ -142,49 +160,48 @@ void loop() {
     lastBlink = millis();
     if (data.flameDetected) needsRedraw = true;
   }
-  
-  delay(50);
+
+  // 10 s funcionando: la imagen OTA (si la hay) se da por buena
+  if (millis() > 10000) otaRxConfirmBoot();
+
+  // Esperar al próximo evento (UART, táctil) o a lo próximo que toque hacer
+  unsigned long now = millis();
+  unsigned long wait = touchPressed ? 50UL : POWER_MAX_WAIT_MS;
+  if (needsRedraw && powerScreenOn()) wait = min(wait, 100UL - min(now - lastUpdate, 100UL));
+  if (data.flameDetected) wait = min(wait, 1000UL - min(now - lastBlink, 1000UL));
+  powerWait(wait);
 }
 
 void readSerial() {
   while (Serial.available()) {
-    char c = Serial.read();
-    if (c == '\n') {
-      if (inputBuffer.length() > 0) {
-        parseData(inputBuffer);
-        inputBuffer = "";
-      }
-    } else {
-      inputBuffer += c;
-    }
+    if (usbLine.push(Serial.read())) parseData(usbLine);
   }
   
-  // Leer desde UART
-  if (Serial2.available()) {
-    String message = Serial2.readStringUntil('\n');
-    if (message.length() > 0) {
-      parseData(message);
-    }
+  // Leer desde UART sin bloquear: lo que esté en el buffer, línea a línea.
+  // Tras un anuncio OTA los bytes siguientes ya son tramas (otaRxPoll)
+  while (Serial2.available() && !otaRxActive()) {
+    if (uartLine.push(Serial2.read())) parseData(uartLine);
   }
 }
 
-void parseData(String jsonData) {
+void parseData(LineReader& line) {
   JsonDocument doc;
-  DeserializationError error = deserializeJson(doc, jsonData);
+  DeserializationError error;
+  LineKind kind = decodeLine(doc, line.buf, line.len, data, &error);
+  line.consumed();
   
-  if (error) {
+  if (kind == LINE_ERROR) {
     Serial.println("Error JSON: " + String(error.c_str()));
     return;
   }
 
-  data.trashLevel = doc["trashLevel"] | data.trashLevel;
-  data.temperature = doc["temperature"] | data.temperature;
-  data.humidity = doc["humidity"] | data.humidity;
-  data.flameDetected = doc["flameDetected"] | data.flameDetected;
-  data.batteryLevel = doc["batteryLevel"] | data.batteryLevel;
-  data.userTokens = doc["userTokens"] | data.userTokens;
-  data.dailyDeposits = doc["dailyDeposits"] | data.dailyDeposits;
-  data.connected = true;
+  if (kind == LINE_OTA) {
+    otaRxAnnounce(doc);
+    return;
+  }
+
+  if (data.flameDetected) powerActivity();   // La alarma enciende la pantalla
+  if (powerScreenOn()) renderMarkData();
   
   needsRedraw = true;
   Serial.println("Datos actualizados");
@@ -202,7 +219,9 @@ void sendCommand(String command) {
 }
 
 void handleTouch() {
+  powerIgnoreTouchIrq(true);
   TouchPoint p = ts.getTouch();
+  powerIgnoreTouchIrq(false);
 
   touchPressed = (p.zRaw > 0);
 
@@ -211,6 +230,7 @@ void handleTouch() {
   
   if (touchJustPressed) {
     Serial.printf("Touch detectado en: x=%d, y=%d\n", p.x, p.y);
+    powerActivity();
     
     if (currentScreen == 0) {
       for (int i = 0; i < 3; i++) {
@@ -218,6 +238,7 @@ void handleTouch() {
           buttons[i].pressed = true;
           buttons[i].justPressed = true;
           needsRedraw = true;
+          renderMarkTouch();
           Serial.printf("Botón %d presionado\n", i);
           break;
         }
@@ -228,6 +249,7 @@ void handleTouch() {
         backButton.pressed = true;
         backButton.justPressed = true;
         needsRedraw = true;
+        renderMarkTouch();
         Serial.println("Botón volver presionado");
       }
     }
@@ -258,6 +280,7 @@ void handleTouch() {
               break;
           }
           needsRedraw = true;
+          renderMarkTouch();
           break;
         }
       }
@@ -268,6 +291,7 @@ void handleTouch() {
         backButton.justReleased = true;
         currentScreen = 0;
         needsRedraw = true;
+        renderMarkTouch();
         Serial.println("Regresando a pantalla principal");
       }
     }
@@ -290,11 +314,14 @@ bool isPointInButton(int x, int y, Button &btn) {
 void updateDisplay() {
   if (!needsRedraw) return;
   
+  uint32_t bytesBefore = tft.bytesPushed;
+  uint32_t drawStart = micros();
   switch (currentScreen) {
     case 0: showMainScreen(); break;
     case 1: showStatsScreen(); break;
     case 2: showConfigScreen(); break;
   }
+  renderFrameDone(currentScreen, micros() - drawStart, tft.bytesPushed - bytesBefore);
   
   needsRedraw = false;
 }
@@ -370,11 +397,39 @@ void showConfigScreen() {
   y += 20;
   tft.drawString("Bateria: " + String(data.batteryLevel, 1) + " %", 10, y);
   y += 20;
-  tft.drawString("Memoria libre: OK", 10, y);
+  drawRenderStats(y);
 
   drawButton(backButton);
 }
 
+// Tiempos de dibujo de la última ventana (rendermetrics.h)
+void drawRenderStats(int y) {
+  tft.drawString("Panel " + String(RENDER_PANEL) + "  Memoria libre: " + String(ESP.getFreeHeap() / 1024) + " KB", 10, y);
+  y += 15;
+  tft.setTextColor(CYAN);
+  tft.drawString("Dibujo p50/p99 ms   SPI/frame", 10, y);
+  const char* names[RENDER_SCREENS] = {"Main", "Stats", "Config"};
+  for (uint8_t i = 0; i < RENDER_SCREENS; i++) {
+    y += 12;
+    tft.drawString(String(names[i]) + ": " + String(renderPercentile((RenderMetric)i, 50) / 1000.0, 1) + " / " +
+                   String(renderPercentile((RenderMetric)i, 99) / 1000.0, 1) + "   " +
+                   String(renderAvgBytes(i) / 1024) + " KB", 10, y);
+  }
+  y += 12;
+  tft.drawString("Dato->pixel: " + String(renderPercentile(RENDER_DATA_TO_PIXEL, 50) / 1000.0, 1) + " / " +
+                 String(renderPercentile(RENDER_DATA_TO_PIXEL, 99) / 1000.0, 1) + " ms", 10, y);
+  y += 12;
+  tft.drawString("Toque->pixel: " + String(renderPercentile(RENDER_TOUCH_TO_PIXEL, 50) / 1000.0, 1) + " / " +
+                 String(renderPercentile(RENDER_TOUCH_TO_PIXEL, 99) / 1000.0, 1) + " ms", 10, y);
+  y += 12;
+  tft.drawString("Despertar->pixel: " + String(renderPercentile(RENDER_WAKE_TO_PIXEL, 50) / 1000.0, 1) + " / " +
+                 String(renderPercentile(RENDER_WAKE_TO_PIXEL, 99) / 1000.0, 1) + " ms", 10, y);
+  y += 12;
+  tft.drawString("Consumo est.: " + String(powerEstimatedMa(POWER_ACTIVE)) + " mA, reposo " +
+                 String(powerEstimatedMa(POWER_OFF)) + " mA", 10, y);
+  tft.setTextColor(WHITE);
+}
+
 void drawBattery() {
   int x = 275, y = 5;
   tft.drawRect(x, y, 40, 15, WHITE);
@@ -448,7 +503,9 @@ void setLED(int r, int g, int b) {
 }
 
 void updateLEDs() {
-  if (data.flameDetected) {
+  if (!powerScreenOn()) {
+    setLED(0, 0, 0); // Apagados con la pantalla: la llama la vuelve a encender
+  } else if (data.flameDetected) {
     setLED(blinkState ? 1 : 0, 0, 0); // Rojo parpadeante
   } else if (data.trashLevel > 85) {
     setLED(1, 0, 0); // Rojo fijo
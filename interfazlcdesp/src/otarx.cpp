@@ -0,0 +1,288 @@
+#include <Arduino.h>
+#include <Update.h>
+#include <MD5Builder.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <esp_system.h>
+#include <esp32/rom/miniz.h>
+#include <otarx.h>
+
+enum OtaRxMode { OTA_RX_IDLE, OTA_RX_RECEIVING, OTA_RX_SKIPPING };
+
+struct OtaRxSession {
+  uint32_t size;
+  uint32_t rawSize;
+  String md5;
+  String rawMd5;
+  String version;
+  uint32_t received;        // Bytes comprimidos ya aceptados (contiguos)
+  uint32_t written;         // Bytes descomprimidos escritos en flash
+  uint32_t frames;
+  uint32_t crcErrors;
+  uint32_t gaps;
+  uint32_t passes;
+  unsigned long startMs;
+  unsigned long lastFrameMs;
+  bool inflateDone;
+};
+
+static OtaRxMode mode = OTA_RX_IDLE;
+static OtaRxSession session;
+static MD5Builder linkMd5;
+static tinfl_decompressor* inflator = nullptr;
+static uint8_t* dict = nullptr;
+static size_t dictPos = 0;
+
+static OtaFrameDecoder decoder;
+
+// Si algún día el bootloader se compila con rollback, que tampoco marque la
+// app como válida al arrancar: lo hace otaRxConfirmBoot()
+extern "C" bool verifyRollbackLater() {
+  return true;
+}
+
+// Estado del rollback en NVS: "pending", "fails", "image" (MD5 de la imagen
+// pendiente) y "rejected" (MD5 que no se vuelve a instalar)
+#define OTA_RX_NVS "otarx"
+
+static bool crashReset() {
+  esp_reset_reason_t reason = esp_reset_reason();
+  return reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT || reason == ESP_RST_TASK_WDT ||
+         reason == ESP_RST_WDT;
+}
+
+void otaRxBegin() {
+  Preferences prefs;
+  prefs.begin(OTA_RX_NVS, false);
+  if (!prefs.getBool("pending", false)) {
+    prefs.end();
+    return;
+  }
+  uint8_t fails = prefs.getUChar("fails", 0);
+  if (crashReset()) {
+    fails++;
+    prefs.putUChar("fails", fails);
+    Serial.println("OTA: arranque fallido " + String(fails) + "/" + String(OTA_RX_MAX_FAILED_BOOTS));
+  }
+  if (fails < OTA_RX_MAX_FAILED_BOOTS) {
+    prefs.end();
+    return;
+  }
+
+  prefs.putString("rejected", prefs.getString("image", ""));
+  prefs.putBool("pending", false);
+  prefs.putUChar("fails", 0);
+  prefs.end();
+  // Con dos particiones OTA, la "siguiente" es la que arrancaba antes
+  const esp_partition_t* previous = esp_ota_get_next_update_partition(nullptr);
+  if (!previous || esp_ota_set_boot_partition(previous) != ESP_OK) {
+    Serial.println("OTA: no hay imagen anterior valida");
+    return;
+  }
+  Serial.println("OTA: volviendo a la imagen anterior");
+  delay(100);
+  ESP.restart();
+}
+
+static bool rejectedImage(const String& rawMd5) {
+  Preferences prefs;
+  prefs.begin(OTA_RX_NVS, true);
+  bool rejected = prefs.getString("rejected", "") == rawMd5;
+  prefs.end();
+  return rejected;
+}
+
+static void releaseBuffers() {
+  free(inflator);
+  free(dict);
+  inflator = nullptr;
+  dict = nullptr;
+}
+
+static void abortSession(const char* why) {
+  Serial.println("OTA abortada: " + String(why));
+  if (mode == OTA_RX_RECEIVING) Update.abort();
+  releaseBuffers();
+  mode = OTA_RX_IDLE;
+}
+
+bool otaRxActive() {
+  return mode != OTA_RX_IDLE;
+}
+
+bool otaRxAnnounce(JsonDocument& doc) {
+  String md5 = doc["md5"] | "";
+  String rawMd5 = doc["rawMd5"] | "";
+  uint32_t size = doc["size"] | 0;
+  uint32_t rawSize = doc["rawSize"] | 0;
+
+  // Otra pasada de la misma imagen: seguir donde se quedó
+  if (mode == OTA_RX_RECEIVING && md5 == session.md5) {
+    session.passes++;
+    session.lastFrameMs = millis();
+    decoder.reset();
+    return true;
+  }
+  if (mode == OTA_RX_RECEIVING) abortSession("imagen distinta");
+
+  session = OtaRxSession();
+  session.size = size;
+  session.rawSize = rawSize;
+  session.md5 = md5;
+  session.rawMd5 = rawMd5;
+  session.version = doc["version"] | "";
+  session.passes = 1;
+  session.startMs = session.lastFrameMs = millis();
+  decoder.reset();
+
+  // Imagen ya instalada o rechazada: sólo hay que dejar pasar las tramas
+  if (rawMd5 == ESP.getSketchMD5() || size == 0 || md5.length() != 32 || rejectedImage(rawMd5)) {
+    mode = OTA_RX_SKIPPING;
+    return true;
+  }
+
+  inflator = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+  dict = (uint8_t*)malloc(TINFL_LZ_DICT_SIZE);
+  if (!inflator || !dict || !Update.begin(rawSize)) {
+    releaseBuffers();
+    mode = OTA_RX_SKIPPING;
+    Serial.println("OTA: sin memoria o sin particion");
+    return false;
+  }
+  Update.setMD5(rawMd5.c_str());
+  tinfl_init(inflator);
+  dictPos = 0;
+  linkMd5.begin();
+  mode = OTA_RX_RECEIVING;
+  Serial.println("OTA: recibiendo " + session.version + " (" + String(size) + " bytes)");
+  return true;
+}
+
+static bool inflateChunk(const uint8_t* data, size_t len) {
+  bool more = session.received + len < session.size;
+  while (len && !session.inflateDone) {
+    size_t inBytes = len;
+    size_t outBytes = TINFL_LZ_DICT_SIZE - dictPos;
+    tinfl_status status = tinfl_decompress(inflator, data, &inBytes, dict, dict + dictPos, &outBytes,
+      TINFL_FLAG_PARSE_ZLIB_HEADER | (more ? TINFL_FLAG_HAS_MORE_INPUT : 0));
+    if (outBytes && Update.write(dict + dictPos, outBytes) != outBytes) return false;
+    session.written += outBytes;
+    dictPos = (dictPos + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+    data += inBytes;
+    len -= inBytes;
+    if (status == TINFL_STATUS_DONE) session.inflateDone = true;
+    else if (status < TINFL_STATUS_DONE) return false;
+    else if (!inBytes && !outBytes) return false;   // Sin avance
+  }
+  // tinfl puede pedir más salida sin más entrada
+  while (!session.inflateDone && !more && len == 0) {
+    size_t inBytes = 0;
+    size_t outBytes = TINFL_LZ_DICT_SIZE - dictPos;
+    tinfl_status status = tinfl_decompress(inflator, data, &inBytes, dict, dict + dictPos, &outBytes,
+      TINFL_FLAG_PARSE_ZLIB_HEADER);
+    if (outBytes && Update.write(dict + dictPos, outBytes) != outBytes) return false;
+    session.written += outBytes;
+    dictPos = (dictPos + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+    if (status == TINFL_STATUS_DONE) session.inflateDone = true;
+    else if (status != TINFL_STATUS_HAS_MORE_OUTPUT) return false;
+  }
+  return true;
+}
+
+static void finishPass() {
+  if (mode == OTA_RX_SKIPPING) {
+    mode = OTA_RX_IDLE;
+    return;
+  }
+  if (session.received < session.size) {
+    Serial.println("OTA: pasada incompleta en " + String(session.received) + "/" + String(session.size));
+    return;   // Esperar a la siguiente pasada
+  }
+
+  linkMd5.calculate();
+  bool ok = session.inflateDone && linkMd5.toString() == session.md5 && Update.end(true);
+  unsigned long ms = millis() - session.startMs;
+  Serial.printf("{\"type\":\"ota\",\"version\":\"%s\",\"bytes\":%u,\"rawBytes\":%u,\"ms\":%lu,"
+                "\"frames\":%u,\"crcErrors\":%u,\"gaps\":%u,\"passes\":%u,\"result\":\"%s\"}\n",
+                session.version.c_str(), session.received, session.written, ms,
+                session.frames, session.crcErrors, session.gaps, session.passes, ok ? "ok" : "error");
+  if (!ok) {
+    abortSession("verificacion fallida");
+    return;
+  }
+  releaseBuffers();
+  mode = OTA_RX_IDLE;
+
+  Preferences prefs;
+  prefs.begin(OTA_RX_NVS, false);
+  prefs.putBool("pending", true);
+  prefs.putUChar("fails", 0);
+  prefs.putString("image", session.rawMd5);
+  prefs.end();
+  Serial.println("OTA: reiniciando con la imagen nueva");
+  delay(100);
+  ESP.restart();
+}
+
+static void handleFrame() {
+  uint32_t offset = decoder.offset();
+  const uint8_t* data = decoder.data();
+  uint16_t frameLen = decoder.len;
+  session.lastFrameMs = millis();
+  session.frames++;
+
+  if (frameLen == 0) {
+    finishPass();
+    return;
+  }
+  if (mode == OTA_RX_SKIPPING || offset < session.received) return;   // Ya la teníamos
+  if (offset > session.received) {
+    session.gaps++;   // Se perdió una trama: se completa en otra pasada
+    return;
+  }
+
+  linkMd5.add((uint8_t*)data, frameLen);
+  if (!inflateChunk(data, frameLen)) {
+    abortSession("imagen corrupta");
+    return;
+  }
+  session.received += frameLen;
+}
+
+void otaRxPoll(Stream& in) {
+  while (in.available()) {
+    OtaFrameResult result = decoder.push(in.read());
+    if (result == OTA_FRAME_BAD_CRC) {
+      session.crcErrors++;
+    } else if (result == OTA_FRAME_OK) {
+      handleFrame();
+      if (mode == OTA_RX_IDLE) return;
+    }
+  }
+
+  if (mode != OTA_RX_IDLE && millis() - session.lastFrameMs > OTA_RX_IDLE_TIMEOUT) {
+    if (mode == OTA_RX_SKIPPING) mode = OTA_RX_IDLE;
+    else abortSession("sin datos");
+  }
+}
+
+void otaRxConfirmBoot() {
+  static bool confirmed = false;
+  if (confirmed) return;
+  confirmed = true;
+
+  Preferences prefs;
+  prefs.begin(OTA_RX_NVS, false);
+  if (prefs.getBool("pending", false)) {
+    prefs.putBool("pending", false);
+    prefs.putUChar("fails", 0);
+    Serial.println("OTA: imagen confirmada");
+  }
+  prefs.end();
+
+  esp_ota_img_states_t state;
+  if (esp_ota_get_state_partition(esp_ota_get_running_partition(), &state) == ESP_OK &&
+      state == ESP_OTA_IMG_PENDING_VERIFY) {
+    esp_ota_mark_app_valid_cancel_rollback();
+  }
+}
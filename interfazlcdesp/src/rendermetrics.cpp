@@ -0,0 +1,176 @@
+#include <rendermetrics.h>
+
+#define WINDOW_CMD_BYTES 11   // CASET(1+4) + PASET(1+4) + RAMWR(1)
+
+static RenderWindow windows[2];
+static uint8_t current = 0;
+static unsigned long windowStart = 0;
+static unsigned long lastExport = 0;
+static uint32_t dataAtUs = 0;
+static uint32_t touchAtUs = 0;
+static uint32_t wakeAtUs = 0;
+static bool dataPending = false;
+static bool touchPending = false;
+static bool wakePending = false;
+
+static const char* METRIC_NAMES[RENDER_METRIC_COUNT] = {"main", "stats", "config", "dataToPixel", "touchToPixel", "wakeToPixel"};
+
+// ---------------------------------------------------------------------------
+// Conteo de bytes SPI
+
+void CountingTFT::drawPixel(int32_t x, int32_t y, uint32_t color) {
+  bytesPushed += WINDOW_CMD_BYTES + 2;
+  TFT_eSPI::drawPixel(x, y, color);
+}
+
+void CountingTFT::drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) {
+  if (w > 0) bytesPushed += WINDOW_CMD_BYTES + 2 * w;
+  TFT_eSPI::drawFastHLine(x, y, w, color);
+}
+
+void CountingTFT::drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color) {
+  if (h > 0) bytesPushed += WINDOW_CMD_BYTES + 2 * h;
+  TFT_eSPI::drawFastVLine(x, y, h, color);
+}
+
+void CountingTFT::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+  if (w > 0 && h > 0) bytesPushed += WINDOW_CMD_BYTES + 2 * w * h;
+  TFT_eSPI::fillRect(x, y, w, h, color);
+}
+
+// Con fondo y tamaño 1 el carácter va en bloque (6x8); si no, la librería
+// lo dibuja con drawPixel/fillRect y ya se cuenta ahí
+void CountingTFT::drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32_t bg, uint8_t size) {
+  if (bg != color && size == 1) bytesPushed += WINDOW_CMD_BYTES + 2 * 6 * 8;
+  TFT_eSPI::drawChar(x, y, c, color, bg, size);
+}
+
+// ---------------------------------------------------------------------------
+// Histogramas
+
+static uint8_t bucketFor(uint32_t us) {
+  uint8_t idx = us ? 32 - __builtin_clz(us) : 0;
+  return idx < RENDER_HIST_BUCKETS ? idx : RENDER_HIST_BUCKETS - 1;
+}
+
+static void rollWindow() {
+  if (millis() - windowStart < RENDER_WINDOW_MS) return;
+  windowStart = millis();
+  current ^= 1;
+  memset(&windows[current], 0, sizeof(RenderWindow));
+}
+
+static void record(RenderMetric m, uint32_t us) {
+  RenderHistogram& h = windows[current].hist[m];
+  h.buckets[bucketFor(us)]++;
+  h.count++;
+  h.sumUs += us;
+  if (us > h.maxUs) h.maxUs = us;
+}
+
+void renderMarkData() {
+  if (dataPending) return;   // Cuenta desde el primer dato sin mostrar
+  dataAtUs = micros();
+  dataPending = true;
+}
+
+void renderMarkTouch() {
+  touchAtUs = micros();
+  touchPending = true;
+}
+
+void renderMarkWake(uint32_t atUs) {
+  wakeAtUs = atUs;
+  wakePending = true;
+}
+
+void renderFrameDone(uint8_t screen, uint32_t drawUs, uint32_t bytes) {
+  rollWindow();
+  uint32_t now = micros();
+  if (screen < RENDER_SCREENS) {
+    record((RenderMetric)screen, drawUs);
+    windows[current].spiBytes[screen] += bytes;
+  }
+  if (dataPending) {
+    record(RENDER_DATA_TO_PIXEL, now - dataAtUs);
+    dataPending = false;
+  }
+  if (touchPending) {
+    record(RENDER_TOUCH_TO_PIXEL, now - touchAtUs);
+    touchPending = false;
+  }
+  if (wakePending) {
+    record(RENDER_WAKE_TO_PIXEL, now - wakeAtUs);
+    wakePending = false;
+  }
+}
+
+// Ventana actual + anterior
+static void combined(RenderMetric m, RenderHistogram& out) {
+  memset(&out, 0, sizeof(out));
+  for (uint8_t w = 0; w < 2; w++) {
+    const RenderHistogram& h = windows[w].hist[m];
+    for (uint8_t i = 0; i < RENDER_HIST_BUCKETS; i++) out.buckets[i] += h.buckets[i];
+    out.count += h.count;
+    out.sumUs += h.sumUs;
+    if (h.maxUs > out.maxUs) out.maxUs = h.maxUs;
+  }
+}
+
+// Percentil aproximado: límite superior de la cubeta que lo contiene
+static uint32_t percentileOf(const RenderHistogram& h, uint8_t pct) {
+  if (h.count == 0) return 0;
+  uint32_t target = ((uint64_t)h.count * pct + 99) / 100;
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < RENDER_HIST_BUCKETS; i++) {
+    seen += h.buckets[i];
+    if (seen >= target) return i == RENDER_HIST_BUCKETS - 1 ? h.maxUs : min(1UL << i, (unsigned long)h.maxUs);
+  }
+  return h.maxUs;
+}
+
+uint32_t renderPercentile(RenderMetric m, uint8_t pct) {
+  RenderHistogram h;
+  combined(m, h);
+  return percentileOf(h, pct);
+}
+
+uint32_t renderAvgBytes(uint8_t screen) {
+  uint64_t bytes = windows[0].spiBytes[screen] + windows[1].spiBytes[screen];
+  uint32_t frames = windows[0].hist[screen].count + windows[1].hist[screen].count;
+  return frames ? bytes / frames : 0;
+}
+
+String renderToJson() {
+  String json = "{";
+  json += "\"type\":\"render\",";
+  json += "\"panel\":\"" + String(RENDER_PANEL) + "\",";
+  json += "\"heap\":" + String(ESP.getFreeHeap()) + ",";
+  json += "\"windowS\":" + String(RENDER_WINDOW_MS / 1000);
+  for (uint8_t m = 0; m < RENDER_METRIC_COUNT; m++) {
+    RenderHistogram h;
+    combined((RenderMetric)m, h);
+    json += ",\"" + String(METRIC_NAMES[m]) + "\":{";
+    json += "\"n\":" + String(h.count) + ",";
+    json += "\"avg\":" + String(h.count ? (uint32_t)(h.sumUs / h.count) : 0) + ",";
+    json += "\"p50\":" + String(percentileOf(h, 50)) + ",";
+    json += "\"p99\":" + String(percentileOf(h, 99)) + ",";
+    json += "\"max\":" + String(h.maxUs) + ",";
+    if (m < RENDER_SCREENS) json += "\"spiBytes\":" + String(renderAvgBytes(m)) + ",";
+    json += "\"hist\":[";
+    for (uint8_t i = 0; i < RENDER_HIST_BUCKETS; i++) {
+      if (i) json += ",";
+      json += String(h.buckets[i]);
+    }
+    json += "]}";
+  }
+  json += "}";
+  return json;
+}
+
+void renderLoop() {
+  rollWindow();
+  if (millis() - lastExport < RENDER_SERIAL_INTERVAL) return;
+  lastExport = millis();
+  Serial.println(renderToJson());
+}
@@ -0,0 +1,48 @@
+// Publica una imagen OTA para server.cjs.
+// Uso: node ota-publish.cjs <esp8266|display> <firmware.bin> <version>
+//
+// El ESP8266 recibe la imagen con gzip (la descomprime eboot al arrancar) y la
+// pantalla con zlib (la descomprime tinfl mientras la graba). La versión que
+// estaba publicada pasa a "previous" para poder volver atrás.
+
+const fs = require('fs');
+const path = require('path');
+const zlib = require('zlib');
+const crypto = require('crypto');
+
+const OTA_DIR = process.env.OTA_DIR || path.join(__dirname, 'ota');
+const [target, binFile, version] = process.argv.slice(2);
+
+if (!['esp8266', 'display'].includes(target) || !binFile || !version) {
+    console.error('Uso: node ota-publish.cjs <esp8266|display> <firmware.bin> <version>');
+    process.exit(1);
+}
+
+const md5 = (buf) => crypto.createHash('md5').update(buf).digest('hex');
+
+const raw = fs.readFileSync(binFile);
+const image = target === 'esp8266'
+    ? zlib.gzipSync(raw, { level: 9 })
+    : zlib.deflateSync(raw, { level: 9 });
+
+const manifest = {
+    version,
+    size: image.length,
+    md5: md5(image),
+    rawSize: raw.length,
+    rawMd5: md5(raw),
+    published: new Date().toISOString()
+};
+
+const current = path.join(OTA_DIR, target, 'current');
+const previous = path.join(OTA_DIR, target, 'previous');
+if (fs.existsSync(current)) {
+    fs.rmSync(previous, { recursive: true, force: true });
+    fs.renameSync(current, previous);
+}
+fs.mkdirSync(current, { recursive: true });
+fs.writeFileSync(path.join(current, 'image.bin'), image);
+fs.writeFileSync(path.join(current, 'manifest.json'), JSON.stringify(manifest, null, 2));
+
+const ratio = (100 * image.length / raw.length).toFixed(1);
+console.log(`${target} ${version}: ${raw.length} -> ${image.length} bytes (${ratio}%)`);
@@ -2,12 +2,25 @@ const express = require('express');
 const fs = require('fs');
 const path = require('path');
 const cors = require('cors');
+const { spawn } = require('child_process');
+const readline = require('readline');
 
 const app = express();
 const PORT = 3000;
 const DATA_FILE = path.join(__dirname, 'data.json');
 const COMMAND_FILE = path.join(__dirname, 'command.json');
 
+// Almacén de series (almacenseries). Si el binario no está compilado se
+// sigue usando data.json como antes.
+const STORE_BIN = process.env.ALMACEN_BIN || path.join(__dirname, '..', 'almacenseries', '.pio', 'build', 'native', 'program');
+const STORE_DIR = process.env.ALMACEN_DIR || path.join(__dirname, 'almacen');
+const SINCE_LIMIT = 10000;
+
+// Imágenes OTA publicadas con ota-publish.cjs: ota/<esp8266|display>/<current|previous>/
+const OTA_DIR = process.env.OTA_DIR || path.join(__dirname, 'ota');
+const OTA_TARGETS = ['esp8266', 'display'];
+const OTA_SLOTS = ['current', 'previous'];
+
 app.use(express.json());
 app.use(cors());
 
@@ -20,23 +33,60 @@ if (!fs.existsSync(COMMAND_FILE)) {
     fs.writeFileSync(COMMAND_FILE, JSON.stringify({ command: '' }));
 }
 
+// Proceso "almacen serve": una orden por línea, una respuesta JSON por línea, en orden
+function startStore() {
+    const proc = spawn(STORE_BIN, [STORE_DIR, 'serve'], { stdio: ['pipe', 'pipe', 'inherit'] });
+    const pending = [];
+
+    readline.createInterface({ input: proc.stdout }).on('line', (line) => {
+        const p = pending.shift();
+        if (!p) return;
+        try {
+            p.resolve(JSON.parse(line));
+        } catch (error) {
+            p.reject(error);
+        }
+    });
+    proc.on('exit', (code) => {
+        console.error(`almacen terminó (código ${code}), se vuelve a data.json`);
+        pending.splice(0).forEach((p) => p.reject(new Error('almacen no disponible')));
+        store = null;
+    });
+
+    return {
+        query(cmd) {
+            return new Promise((resolve, reject) => {
+                pending.push({ resolve, reject });
+                proc.stdin.write(cmd + '\n');
+            });
+        }
+    };
+}
+
+let store = fs.existsSync(STORE_BIN) ? startStore() : null;
+
 // Endpoint para recibir datos del ESP
-app.post('/data', (req, res) => {
+app.post('/data', async (req, res) => {
     const newData = req.body;
     
     try {
-        // Leer datos existentes
-        const rawData = fs.readFileSync(DATA_FILE);
-        const data = JSON.parse(rawData);
-        
-        // Actualizar con nuevos datos
-        const timestamp = new Date().toISOString();
-        const updatedData = {
-            ...data,
-            [timestamp]: newData
-        };
+        if (store) {
+            const result = await store.query(`A ${Date.now()} ${JSON.stringify(newData)}`);
+            if (!result.ok) throw new Error(result.error);
+        } else {
+            // Leer datos existentes
+            const rawData = fs.readFileSync(DATA_FILE);
+            const data = JSON.parse(rawData);
+            
+            // Actualizar con nuevos datos
+            const timestamp = new Date().toISOString();
+            const updatedData = {
+                ...data,
+                [timestamp]: newData
+            };
 
-        fs.writeFileSync(DATA_FILE, JSON.stringify(updatedData, null, 2));
+            fs.writeFileSync(DATA_FILE, JSON.stringify(updatedData, null, 2));
+        }
 
         const commandData = JSON.parse(fs.readFileSync(COMMAND_FILE));
         const response = commandData.command ? { command: commandData.command } : { status: 'Datos recibidos' };
@@ -52,18 +102,112 @@ app.post('/data', (req, res) => {
     }
 });
 
-// Endpoint para que el frontend obtenga datos
-app.get('/data', (req, res) => {
+// Endpoint para que el frontend obtenga datos (?since=<ISO|ms> opcional)
+app.get('/data', async (req, res) => {
     try {
+        const since = req.query.since ? Date.parse(req.query.since) || Number(req.query.since) : 0;
+        if (store) {
+            const rows = await store.query(`S ${since} ${SINCE_LIMIT}`);
+            res.json(Object.fromEntries(rows.map((r) => [r.ts, r])));
+            return;
+        }
         const rawData = fs.readFileSync(DATA_FILE);
-        res.header('Content-Type', 'application/json');
-        res.send(rawData);
+        if (!since) {
+            res.header('Content-Type', 'application/json');
+            res.send(rawData);
+            return;
+        }
+        const data = JSON.parse(rawData);
+        res.json(Object.fromEntries(Object.entries(data).filter(([ts]) => Date.parse(ts) >= since)));
     } catch (error) {
         console.error('Error GET /data:', error);
         res.status(500).send('Error leyendo datos');
     }
 });
 
+// Último valor de cada contenedor: { "<id>": { ...muestra, ts } }
+app.get('/data/latest', async (req, res) => {
+    try {
+        if (store) {
+            res.json(await store.query('L'));
+            return;
+        }
+        const data = JSON.parse(fs.readFileSync(DATA_FILE));
+        const latest = {};
+        for (const [ts, sample] of Object.entries(data)) {
+            const id = sample.id || 'sin_id';
+            if (!latest[id] || latest[id].ts < ts) latest[id] = { ...sample, ts };
+        }
+        res.json(latest);
+    } catch (error) {
+        console.error('Error GET /data/latest:', error);
+        res.status(500).send('Error leyendo datos');
+    }
+});
+
+// Serie submuestreada: ?device=<id>&from=<ISO|ms>&to=<ISO|ms>&bucket=<s>
+app.get('/data/range', async (req, res) => {
+    const { device, from, to, bucket } = req.query;
+    if (!store) {
+        return res.status(501).send('Requiere almacenseries');
+    }
+    if (!device || /\s/.test(device)) {
+        return res.status(400).send('Dispositivo requerido');
+    }
+    try {
+        const fromMs = Date.parse(from) || Number(from) || 0;
+        const toMs = Date.parse(to) || Number(to) || Date.now();
+        const bucketMs = Math.max(1, Number(bucket) || 60) * 1000;
+        res.json(await store.query(`R ${device} ${fromMs} ${toMs} ${bucketMs}`));
+    } catch (error) {
+        console.error('Error GET /data/range:', error);
+        res.status(500).send('Error leyendo datos');
+    }
+});
+
+// Métricas de ejecución del ESP (solo la última muestra, en memoria)
+let latestMetrics = {};
+
+app.post('/metrics', (req, res) => {
+    latestMetrics = { ...req.body, receivedAt: new Date().toISOString() };
+    res.json({ status: 'Metricas recibidas' });
+});
+
+app.get('/metrics', (req, res) => {
+    res.json(latestMetrics);
+});
+
+// OTA: manifiesto e imagen. sendFile atiende "Range", que el ESP usa para reanudar
+function otaFile(req, res, name) {
+    const { target, slot } = req.params;
+    if (!OTA_TARGETS.includes(target) || !OTA_SLOTS.includes(slot)) {
+        return res.status(404).send('Imagen no encontrada');
+    }
+    const file = path.join(OTA_DIR, target, slot, name);
+    if (!fs.existsSync(file)) {
+        return res.status(404).send('Imagen no encontrada');
+    }
+    res.sendFile(file);
+}
+
+app.get('/ota/:target/:slot/manifest', (req, res) => otaFile(req, res, 'manifest.json'));
+app.get('/ota/:target/:slot/image', (req, res) => otaFile(req, res, 'image.bin'));
+
+// Resultado de cada actualización (las últimas, en memoria)
+const otaReports = [];
+
+app.post('/ota/report', (req, res) => {
+    const report = { ...req.body, receivedAt: new Date().toISOString() };
+    otaReports.push(report);
+    if (otaReports.length > 100) otaReports.shift();
+    console.log(`OTA ${report.target} ${report.version}: ${report.result} (${report.bytes} bytes, ${report.resumes} reanudaciones, ${report.ms} ms)`);
+    res.json({ status: 'Reporte recibido' });
+});
+
+app.get('/ota/report', (req, res) => {
+    res.json(otaReports);
+});
+
 // Endpoint para recibir comandos del frontend
 app.post('/command', (req, res) => {
     const { command } = req.body;
@@ -95,4 +239,5 @@ app.get('/command', (req, res) => {
 app.listen(PORT, () => {
     console.log(`Servidor ejecutándose en http://localhost:${PORT}`);
     console.log(`ESP32 debe enviar datos a: http://192.168.100.3:${PORT}/data`);
+    console.log(store ? `Almacén de series: ${STORE_DIR}` : 'Almacén de series no compilado, usando data.json');
 });
\ No newline at end of file
@@ -49,11 +49,12 @@ function App() {
   useEffect(() => {
     const fetchData = async () => {
       try {
-        const res = await fetch('http://localhost:3000/data');
-        const allData = await res.json();
-        const lastKey = Object.keys(allData).sort().pop();
-        if (lastKey) {
-          setSensorData(allData[lastKey]);
+        const res = await fetch('http://localhost:3000/data/latest');
+        const latest: Record<string, SensorData & { ts: string }> = await res.json();
+        const newest = Object.values(latest).reduce<(SensorData & { ts: string }) | undefined>(
+          (best, d) => (!best || d.ts > best.ts ? d : best), undefined);
+        if (newest) {
+          setSensorData(newest);
         }
       } catch (err) {
         console.error('Error al obtener datos del backend:', err);